@@ -0,0 +1,150 @@
+// dcache.cc
+//	Routines to manage the directory entry cache.  See dcache.h.
+//
+// Copyright (c) 1992-1993 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#include "copyright.h"
+#include "debug.h"
+#include "dcache.h"
+
+//----------------------------------------------------------------------
+// DentryKeyOf, HashDentryKey
+// 	Routines used by the cache's hash table -- to get the key of an
+//	entry, and to hash a key.  The hash of the name is mixed with the
+//	directory's sector.
+//----------------------------------------------------------------------
+
+static DentryKey
+DentryKeyOf(Dentry *entry)
+{
+    return DentryKey(entry->parent, entry->name, entry->hash);
+}
+
+static unsigned
+HashDentryKey(DentryKey key)
+{
+    return (key.hash ^ (unsigned) key.parent) * 16777619u;
+}
+
+//----------------------------------------------------------------------
+// DentryCache::DentryCache
+// 	Initialize an empty cache.
+//
+//	"size" is the number of lookups the cache can hold
+//----------------------------------------------------------------------
+
+DentryCache::DentryCache(int size)
+{
+    pool = new Dentry[size];
+    poolSize = size;
+    hand = 0;
+    for (int i = 0; i < poolSize; i++)
+	pool[i].inUse = FALSE;
+    index = new HashTable<DentryKey, Dentry *>(DentryKeyOf, HashDentryKey);
+}
+
+//----------------------------------------------------------------------
+// DentryCache::~DentryCache
+// 	De-allocate the cache.
+//----------------------------------------------------------------------
+
+DentryCache::~DentryCache()
+{
+    for (int i = 0; i < poolSize; i++)
+	if (pool[i].inUse)
+	    (void) index->Remove(DentryKeyOf(&pool[i]));
+    delete index;
+    delete [] pool;
+}
+
+//----------------------------------------------------------------------
+// DentryCache::Lookup
+// 	Look up "name" in the directory whose header is at "parent".
+//	Return TRUE, with the file's header sector and whether it is a
+//	directory, if the lookup is cached; otherwise return FALSE.
+//
+//	"parent" -- the header sector of the directory
+//	"name" -- the name to look up
+//	"sector", "isDir" -- where to return the result
+//----------------------------------------------------------------------
+
+bool
+DentryCache::Lookup(int parent, char *name, int *sector, bool *isDir)
+{
+    Dentry *entry;
+
+    if (!index->Find(DentryKey(parent, name), &entry))
+	return FALSE;
+    entry->referenced = TRUE;
+    *sector = entry->sector;
+    *isDir = entry->isDir;
+    return TRUE;
+}
+
+//----------------------------------------------------------------------
+// DentryCache::Enter
+// 	Remember that "name" in directory "parent" is the file whose
+//	header is at "sector".  If the cache is full, the clock hand
+//	picks an entry to replace: it skips (and clears) entries used
+//	since it last came round.
+//
+//	"parent" -- the header sector of the directory
+//	"name" -- the name in the directory
+//	"sector" -- the header sector of the file
+//	"isDir" -- is the file a directory?
+//----------------------------------------------------------------------
+
+void
+DentryCache::Enter(int parent, char *name, int sector, bool isDir)
+{
+    DentryKey key(parent, name);
+    Dentry *entry;
+
+    if (index->Find(key, &entry)) {		// already cached: refresh it
+	(void) index->Remove(key);
+	entry->inUse = FALSE;
+    }
+    for (;;) {
+	entry = &pool[hand];
+	hand = (hand + 1) % poolSize;
+	if (!entry->inUse)
+	    break;
+	if (!entry->referenced) {
+	    DEBUG(dbgFile, "Dentry cache evicts " << entry->name);
+	    (void) index->Remove(DentryKeyOf(entry));
+	    break;
+	}
+	entry->referenced = FALSE;
+    }
+
+    entry->inUse = TRUE;
+    entry->referenced = FALSE;
+    entry->parent = parent;
+    strncpy(entry->name, name, FileNameMaxLen);
+    entry->name[FileNameMaxLen] = '\0';
+    entry->hash = key.hash;
+    entry->sector = sector;
+    entry->isDir = isDir;
+    index->Insert(entry);
+}
+
+//----------------------------------------------------------------------
+// DentryCache::Invalidate
+// 	Forget any cached lookup of "name" in directory "parent".
+//
+//	"parent" -- the header sector of the directory
+//	"name" -- the name in the directory
+//----------------------------------------------------------------------
+
+void
+DentryCache::Invalidate(int parent, char *name)
+{
+    Dentry *entry;
+
+    if (!index->Find(DentryKey(parent, name), &entry))
+	return;
+    (void) index->Remove(DentryKeyOf(entry));
+    entry->inUse = FALSE;
+}
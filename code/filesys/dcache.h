@@ -0,0 +1,83 @@
+// dcache.h
+//	Data structures for the directory entry ("dentry") cache.
+//
+//	Opening a file by its path means looking up each name on the
+//	path in the directory before it.  Outside the root directory,
+//	each of those lookups would read a directory back from disk.
+//	The dentry cache remembers the result of recent lookups: for
+//	a name in a directory, where the file header is, and whether
+//	the file is itself a directory.
+//
+//	The cache holds a bounded number of entries.  When it is full,
+//	a new entry replaces an old one chosen by the clock algorithm:
+//	entries used since the hand last passed get a second chance.
+//
+//      We assume mutual exclusion is provided by the caller, and that
+//	the caller invalidates the entry for any name it removes.
+//
+// Copyright (c) 1992-1993 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#ifndef DCACHE_H
+#define DCACHE_H
+
+#include "copyright.h"
+#include "directory.h"
+#include "hash.h"
+
+#define NumDentries	64		// how many lookups are remembered
+
+// The following class defines a cached lookup: the name "name" in
+// the directory whose header is at sector "parent" refers to the file
+// whose header is at sector "sector".
+
+class Dentry {
+  public:
+    bool inUse;				// Is this entry in use?
+    bool referenced;			// Used since the clock hand passed?
+    int parent;				// Header sector of the directory
+    char name[FileNameMaxLen + 1];	// Name within that directory
+    unsigned hash;			// Hash of the name (HashFileName)
+    int sector;				// Header sector of the file
+    bool isDir;				// Is the file a directory?
+};
+
+// The key of the cache's hash table: a directory and a name in it.
+// As in the directory, the name's hash is compared before the name.
+
+class DentryKey {
+  public:
+    DentryKey(int p, char *n) { parent = p; name = n; hash = HashFileName(n); }
+    DentryKey(int p, char *n, unsigned h) { parent = p; name = n; hash = h; }
+    bool operator==(const DentryKey &other) const
+	{ return parent == other.parent && hash == other.hash
+		&& strcmp(name, other.name) == 0; }
+
+    int parent;
+    char *name;
+    unsigned hash;
+};
+
+class DentryCache {
+  public:
+    DentryCache(int size = NumDentries);	// Initialize an empty cache
+    ~DentryCache();			// De-allocate the cache
+
+    bool Lookup(int parent, char *name, int *sector, bool *isDir);
+					// Find a cached lookup; FALSE if
+					// there is none
+    void Enter(int parent, char *name, int sector, bool isDir);
+					// Remember the result of a lookup
+    void Invalidate(int parent, char *name);
+					// Forget "name" in "parent", if
+					// it is cached
+
+  private:
+    Dentry *pool;			// The cache entries
+    int poolSize;			// Number of entries
+    int hand;				// Next entry the clock looks at
+    HashTable<DentryKey, Dentry *> *index;	// Finds the entry for a key
+};
+
+#endif // DCACHE_H
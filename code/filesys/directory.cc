@@ -1,29 +1,78 @@
 // directory.cc 
 //	Routines to manage a directory of file names.
 //
-//	The directory is a table of fixed length entries; each
+//	The directory is a sequence of variable length entries; each
 //	entry represents a single file, and contains the file name,
-//	and the location of the file header on disk.  The fixed size
-//	of each directory entry means that we have the restriction
-//	of a fixed maximum size for file names.
+//	and the location of the file header on disk.  An entry only
+//	takes up as much room as its name needs, so many short names
+//	share a disk sector, and names can be up to FileNameMaxLen
+//	bytes long.  (cf. DirectoryEntry in directory.h)
 //
 //	The constructor initializes an empty directory of a certain size;
 //	we use ReadFrom/WriteBack to fetch the contents of the directory
 //	from disk, and to write back any modifications back to disk.
 //
-//	Also, this implementation has the restriction that the size
-//	of the directory cannot expand.  In other words, once all the
-//	entries in the directory are used, no more files can be created.
+//	Names are looked up through a hash table built over the entries
+//	in use.  The hash table only lives in memory; it is rebuilt
+//	whenever the table is replaced wholesale (FetchFrom, Revert),
+//	and kept up to date by Add and Remove.  Each entry keeps the
+//	hash of its name, so rebuilding the hash table, and comparing
+//	names that are not equal, hardly ever needs to look at the names.
+//
+//	Removing a file leaves a free record behind.  Add takes the
+//	first free record long enough for the new name (joining free
+//	records that are next to each other on the way), splitting off
+//	what is left over.  When there is none, the table doubles in
+//	size; the file system extends the directory file to match before
+//	writing the directory back.
 //
 // Copyright (c) 1992-1993 The Regents of the University of California.
 // All rights reserved.  See copyright.h for copyright notice and limitation 
 // of liability and disclaimer of warranty provisions.
 
 #include "copyright.h"
+#include "debug.h"
 #include "utility.h"
 #include "filehdr.h"
 #include "directory.h"
 
+//----------------------------------------------------------------------
+// HashFileName
+// 	Return the hash of a file name, as kept in its directory entry.
+//	(This is the FNV-1a string hash.)
+//----------------------------------------------------------------------
+
+unsigned
+HashFileName(char *name)
+{
+    unsigned h = 2166136261u;
+
+    for (; *name != '\0'; name++) {
+	h ^= (unsigned char) *name;
+	h *= 16777619u;
+    }
+    return h;
+}
+
+//----------------------------------------------------------------------
+// EntryName, EntryHash
+// 	Routines used by the directory's hash table -- to get the key
+//	of a directory entry, and to hash a key.  The key already holds
+//	the hash of the name.
+//----------------------------------------------------------------------
+
+static FileNameKey
+EntryName(DirectoryEntry *entry)
+{
+    return FileNameKey(entry->Name(), entry->hash);
+}
+
+static unsigned
+EntryHash(FileNameKey key)
+{
+    return key.hash;
+}
+
 //----------------------------------------------------------------------
 // Directory::Directory
 // 	Initialize a directory; initially, the directory is completely
@@ -31,15 +80,21 @@
 //	is all we need, but otherwise, we need to call FetchFrom in order
 //	to initialize it from disk.
 //
-//	"size" is the number of entries in the directory
+//	"size" is the number of bytes in the directory; a multiple of 4
 //----------------------------------------------------------------------
 
 Directory::Directory(int size)
 {
-    table = new DirectoryEntry[size];
+    ASSERT(size % 4 == 0);
+    table = new char[size];
+    diskTable = new char[size];
+    diskTableSize = size;
+    diskTableValid = FALSE;
     tableSize = size;
-    for (int i = 0; i < tableSize; i++)
-	table[i].inUse = FALSE;
+    bzero(table, size);
+    MakeFree(0, size);
+    index = new HashTable<FileNameKey, DirectoryEntry *>(EntryName, 
+							EntryHash);
 }
 
 //----------------------------------------------------------------------
@@ -48,13 +103,17 @@ Directory::Directory(int size)
 //----------------------------------------------------------------------
 
 Directory::~Directory()
-{ 
+{
+    ClearIndex();
+    delete index;
     delete [] table;
-} 
+    delete [] diskTable;
+}
 
 //----------------------------------------------------------------------
 // Directory::FetchFrom
-// 	Read the contents of the directory from disk.
+// 	Read the contents of the directory from disk.  The table takes
+//	the size of the file.
 //
 //	"file" -- file containing the directory contents
 //----------------------------------------------------------------------
@@ -62,12 +121,28 @@ Directory::~Directory()
 void
 Directory::FetchFrom(OpenFile *file)
 {
-    (void) file->ReadAt((char *)table, tableSize * sizeof(DirectoryEntry), 0);
+    int size = file->Length();
+
+    ClearIndex();
+    if (size != tableSize) {
+	delete [] table;
+	delete [] diskTable;
+	table = new char[size];
+	diskTable = new char[size];
+	tableSize = size;
+    }
+    (void) file->ReadAt(table, tableSize, 0);
+    bcopy(table, diskTable, tableSize);
+    diskTableSize = tableSize;
+    diskTableValid = TRUE;
+    BuildIndex();
 }
 
 //----------------------------------------------------------------------
 // Directory::WriteBack
-// 	Write any modifications to the directory back to disk
+// 	Write any modifications to the directory back to disk.  Only
+//	the sectors of the file that differ from what is already on disk 
+//	are written.  The file must be at least FileSize() bytes long.
 //
 //	"file" -- file to contain the new directory contents
 //----------------------------------------------------------------------
@@ -75,24 +150,142 @@ Directory::FetchFrom(OpenFile *file)
 void
 Directory::WriteBack(OpenFile *file)
 {
-    (void) file->WriteAt((char *)table, tableSize * sizeof(DirectoryEntry), 0);
+    ASSERT(file->Length() >= tableSize);
+    for (int offset = 0; offset < tableSize; offset += SectorSize) {
+	int chunk = min(SectorSize, tableSize - offset);
+	if (!diskTableValid || offset + chunk > diskTableSize
+		|| memcmp(&table[offset], &diskTable[offset], chunk) != 0)
+	    (void) file->WriteAt(&table[offset], chunk, offset);
+    }
+    if (diskTableSize != tableSize) {
+	delete [] diskTable;
+	diskTable = new char[tableSize];
+	diskTableSize = tableSize;
+    }
+    bcopy(table, diskTable, tableSize);
+    diskTableValid = TRUE;
+}
+
+//----------------------------------------------------------------------
+// Directory::Revert
+// 	Throw away any changes made since the directory was last read 
+//	from or written to disk.
+//----------------------------------------------------------------------
+
+void
+Directory::Revert()
+{
+    ASSERT(diskTableValid);
+    ClearIndex();
+    if (tableSize != diskTableSize) {		// undo any growth
+	delete [] table;
+	table = new char[diskTableSize];
+	tableSize = diskTableSize;
+    }
+    bcopy(diskTable, table, tableSize);
+    BuildIndex();
+}
+
+//----------------------------------------------------------------------
+// Directory::Resize
+// 	Make the table "size" bytes long, keeping the entries already
+//	there.  The new space is free.
+//----------------------------------------------------------------------
+
+void
+Directory::Resize(int size)
+{
+    char *old = table;
+
+    ASSERT(size >= tableSize && size % 4 == 0);
+    ClearIndex();
+    table = new char[size];
+    bcopy(old, table, tableSize);
+    bzero(&table[tableSize], size - tableSize);
+    MakeFree(tableSize, size - tableSize);
+    tableSize = size;
+    delete [] old;
+    BuildIndex();
+}
+
+//----------------------------------------------------------------------
+// Directory::MakeFree
+// 	Lay out free records over "size" bytes of the table, starting at
+//	"offset".  A free record can be at most MaxEntryLength bytes
+//	long, so a large area takes more than one.
+//----------------------------------------------------------------------
+
+void
+Directory::MakeFree(int offset, int size)
+{
+    while (size > 0) {
+	DirectoryEntry *entry = (DirectoryEntry *) &table[offset];
+	int length = min(size, MaxEntryLength);
+
+	if (size - length > 0 && size - length < MinEntryLength)
+	    length -= MinEntryLength;	// leave room for one more
+	ASSERT(length >= MinEntryLength);
+	entry->sector = -1;
+	entry->length = length;
+	offset += length;
+	size -= length;
+    }
+}
+
+//----------------------------------------------------------------------
+// Directory::BuildIndex
+// 	Put every entry in use into the (empty) hash table.
+//----------------------------------------------------------------------
+
+void
+Directory::BuildIndex()
+{
+    DirectoryEntry *entry;
+
+    ASSERT(index->IsEmpty());
+    for (int offset = 0; offset < tableSize; offset += entry->length) {
+	entry = (DirectoryEntry *) &table[offset];
+	ASSERT(entry->length >= MinEntryLength);
+	if (entry->InUse())
+	    index->Insert(entry);
+    }
+}
+
+//----------------------------------------------------------------------
+// Directory::ClearIndex
+// 	Take every entry out of the hash table.  Must be called while
+//	the hash table still agrees with the contents of the table.
+//----------------------------------------------------------------------
+
+void
+Directory::ClearIndex()
+{
+    DirectoryEntry *entry;
+
+    for (int offset = 0; offset < tableSize; offset += entry->length) {
+	entry = (DirectoryEntry *) &table[offset];
+	if (entry->InUse())
+	    (void) index->Remove(EntryName(entry));
+    }
+    ASSERT(index->IsEmpty());
 }
 
 //----------------------------------------------------------------------
-// Directory::FindIndex
-// 	Look up file name in directory, and return its location in the table of
-//	directory entries.  Return -1 if the name isn't in the directory.
+// Directory::FindEntry
+// 	Look up file name in directory, and return its entry.  Return
+//	NULL if the name isn't in the directory.
 //
 //	"name" -- the file name to look up
 //----------------------------------------------------------------------
 
-int
-Directory::FindIndex(char *name)
+DirectoryEntry *
+Directory::FindEntry(char *name)
 {
-    for (int i = 0; i < tableSize; i++)
-        if (table[i].inUse && !strncmp(table[i].name, name, FileNameMaxLen))
-	    return i;
-    return -1;		// name not in directory
+    DirectoryEntry *entry;
+
+    if (!index->Find(FileNameKey(name), &entry))
+	return NULL;		// name not in directory
+    return entry;
 }
 
 //----------------------------------------------------------------------
@@ -107,70 +300,191 @@ Directory::FindIndex(char *name)
 int
 Directory::Find(char *name)
 {
-    int i = FindIndex(name);
+    DirectoryEntry *entry = FindEntry(name);
 
-    if (i != -1)
-	return table[i].sector;
+    if (entry != NULL)
+	return entry->sector;
     return -1;
 }
 
+//----------------------------------------------------------------------
+// Directory::IsDirectory
+// 	Return TRUE if "name" is in the directory, and is itself a 
+//	directory.
+//
+//	"name" -- the file name to look up
+//----------------------------------------------------------------------
+
+bool
+Directory::IsDirectory(char *name)
+{
+    DirectoryEntry *entry = FindEntry(name);
+
+    return (entry != NULL) && entry->isDir;
+}
+
+//----------------------------------------------------------------------
+// Directory::FindSpace
+// 	Return the first free record at least "length" bytes long, or
+//	NULL if there is none.  Free records that follow one another are
+//	joined together along the way.
+//
+//	"length" -- how long a record is needed
+//----------------------------------------------------------------------
+
+DirectoryEntry *
+Directory::FindSpace(int length)
+{
+    DirectoryEntry *entry, *next;
+    char *end = &table[tableSize];
+
+    for (int offset = 0; offset < tableSize; offset += entry->length) {
+	entry = (DirectoryEntry *) &table[offset];
+	if (entry->InUse())
+	    continue;
+	for (next = entry->Next(); (char *) next < end && !next->InUse()
+		&& entry->length + next->length <= MaxEntryLength;
+		next = entry->Next())
+	    entry->length += next->length;
+	if (entry->length >= length)
+	    return entry;
+    }
+    return NULL;
+}
+
 //----------------------------------------------------------------------
 // Directory::Add
 // 	Add a file into the directory.  Return TRUE if successful;
-//	return FALSE if the file name is already in the directory, or if
-//	the directory is completely full, and has no more space for
-//	additional file names.
+//	return FALSE if the file name is already in the directory, or is
+//	too long.  If there is no free record long enough for the entry,
+//	the table is doubled in size.
 //
 //	"name" -- the name of the file being added
 //	"newSector" -- the disk sector containing the added file's header
+//	"isDir" -- is the file being added a directory?
 //----------------------------------------------------------------------
 
 bool
-Directory::Add(char *name, int newSector)
-{ 
-    if (FindIndex(name) != -1)
+Directory::Add(char *name, int newSector, bool isDir)
+{
+    int nameLen = strlen(name);
+    int length = EntryLength(nameLen);
+    DirectoryEntry *entry;
+
+    if (nameLen == 0 || nameLen > FileNameMaxLen || FindEntry(name) != NULL)
 	return FALSE;
 
-    for (int i = 0; i < tableSize; i++)
-        if (!table[i].inUse) {
-            table[i].inUse = TRUE;
-            strncpy(table[i].name, name, FileNameMaxLen); 
-            table[i].sector = newSector;
-        return TRUE;
-	}
-    return FALSE;	// no space.  Fix when we have extensible files.
+    entry = FindSpace(length);
+    if (entry == NULL) {		// no space: grow the table
+	int oldSize = tableSize;
+
+	Resize(max(2 * tableSize, tableSize + length));
+	entry = (DirectoryEntry *) &table[oldSize];
+    }
+    if (entry->length - length >= MinEntryLength) {
+	DirectoryEntry *rest = (DirectoryEntry *) ((char *) entry + length);
+
+	rest->sector = -1;		// split off what is left
+	rest->length = entry->length - length;
+	entry->length = length;
+    }
+
+    entry->sector = newSector;
+    entry->hash = HashFileName(name);
+    entry->nameLen = nameLen;
+    entry->isDir = isDir;
+    bcopy(name, entry->Name(), nameLen + 1);
+    index->Insert(entry);
+    return TRUE;	
 }
 
 //----------------------------------------------------------------------
 // Directory::Remove
 // 	Remove a file name from the directory.  Return TRUE if successful;
-//	return FALSE if the file isn't in the directory. 
+//	return FALSE if the file isn't in the directory.  The entry's
+//	record becomes free.
 //
 //	"name" -- the file name to be removed
 //----------------------------------------------------------------------
 
 bool
 Directory::Remove(char *name)
-{ 
-    int i = FindIndex(name);
+{
+    DirectoryEntry *entry = FindEntry(name);
 
-    if (i == -1)
+    if (entry == NULL)
 	return FALSE; 		// name not in directory
-    table[i].inUse = FALSE;
+    (void) index->Remove(EntryName(entry));
+    entry->sector = -1;
     return TRUE;	
 }
 
+//----------------------------------------------------------------------
+// Directory::IsEmpty
+// 	Return TRUE if no entry of the directory is in use.
+//----------------------------------------------------------------------
+
+bool
+Directory::IsEmpty()
+{
+    return index->IsEmpty();
+}
+
+//----------------------------------------------------------------------
+// Directory::FileSize
+// 	Return how many bytes the directory takes up on disk.
+//----------------------------------------------------------------------
+
+int
+Directory::FileSize()
+{
+    return tableSize;
+}
+
 //----------------------------------------------------------------------
 // Directory::List
-// 	List all the file names in the directory. 
+// 	List all the file names in the directory, and (as paths) those
+//	in each directory under it.  Directories end with a '/'.
 //----------------------------------------------------------------------
 
 void
 Directory::List()
 {
-   for (int i = 0; i < tableSize; i++)
-	if (table[i].inUse)
-	    printf("%s\n", table[i].name);
+    ListUnder("");
+}
+
+//----------------------------------------------------------------------
+// Directory::ListUnder
+// 	List the directory, putting "prefix" -- the path of the 
+//	directory -- in front of each name.
+//----------------------------------------------------------------------
+
+void
+Directory::ListUnder(char *prefix)
+{
+    DirectoryEntry *entry;
+
+    for (int offset = 0; offset < tableSize; offset += entry->length) {
+	entry = (DirectoryEntry *) &table[offset];
+	if (!entry->InUse())
+	    continue;
+	if (!entry->isDir) {
+	    printf("%s%s\n", prefix, entry->Name());
+	    continue;
+	}
+
+	char *path = new char[strlen(prefix) + entry->nameLen + 2];
+	OpenFile *file = new OpenFile(entry->sector);
+	Directory *dir = new Directory(0);
+
+	sprintf(path, "%s%s/", prefix, entry->Name());
+	printf("%s\n", path);
+	dir->FetchFrom(file);
+	dir->ListUnder(path);
+	delete dir;
+	delete file;
+	delete [] path;
+    }
 }
 
 //----------------------------------------------------------------------
@@ -181,16 +495,19 @@ Directory::List()
 
 void
 Directory::Print()
-{ 
+{
     FileHeader *hdr = new FileHeader;
+    DirectoryEntry *entry;
 
     printf("Directory contents:\n");
-    for (int i = 0; i < tableSize; i++)
-	if (table[i].inUse) {
-	    printf("Name: %s, Sector: %d\n", table[i].name, table[i].sector);
-	    hdr->FetchFrom(table[i].sector);
+    for (int offset = 0; offset < tableSize; offset += entry->length) {
+	entry = (DirectoryEntry *) &table[offset];
+	if (entry->InUse()) {
+	    printf("Name: %s, Sector: %d\n", entry->Name(), entry->sector);
+	    hdr->FetchFrom(entry->sector);
 	    hdr->Print();
 	}
+    }
     printf("\n");
     delete hdr;
 }
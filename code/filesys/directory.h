@@ -4,7 +4,9 @@
 //      A directory is a table of pairs: <file name, sector #>,
 //	giving the name of each file in the directory, and 
 //	where to find its file header (the data structure describing
-//	where to find the file's data blocks) on disk.
+//	where to find the file's data blocks) on disk.  An entry may
+//	itself be a directory, so directories form a tree under the
+//	root directory.
 //
 //      We assume mutual exclusion is provided by the caller.
 //
@@ -18,66 +20,142 @@
 #define DIRECTORY_H
 
 #include "openfile.h"
+#include "hash.h"
 
-#define FileNameMaxLen 		9	// for simplicity, we assume 
-					// file names are <= 9 characters long
+#define FileNameMaxLen 		255	// longest file name (in bytes)
 
 // The following class defines a "directory entry", representing a file
 // in the directory.  Each entry gives the name of the file, and where
 // the file's header is to be found on disk.
 //
+// Entries are records of varying length: the fields below are followed
+// directly by the name (with its trailing '\0'), and then by padding
+// to a multiple of 4 bytes.  An entry that is not in use (sector -1)
+// is free space, which a new entry of the same length or shorter can
+// take over.  The records follow one another with no gaps, "length"
+// bytes apart, from the start of the directory to its end.
+//
 // Internal data structures kept public so that Directory operations can
 // access them directly.
 
 class DirectoryEntry {
   public:
-    bool inUse;				// Is this directory entry in use?
     int sector;				// Location on disk to find the 
-					//   FileHeader for this file 
-    char name[FileNameMaxLen + 1];	// Text name for file, with +1 for 
-					// the trailing '\0'
+					//   FileHeader for this file, or
+					//   -1 if the entry is not in use
+    unsigned hash;			// Hash of the name (HashFileName)
+    unsigned short length;		// Bytes in the record, name and
+					//   padding included
+    unsigned char nameLen;		// Bytes in the name, without '\0'
+    bool isDir;				// Is the file a directory?
+
+    bool InUse() { return sector != -1; }
+    char *Name() { return (char *) this + sizeof(DirectoryEntry); }
+					// Text name for file, which follows
+					//   the fields above
+    DirectoryEntry *Next()
+	{ return (DirectoryEntry *) ((char *) this + length); }
+					// The record after this one
+};
+
+#define EntryLength(nameLen) \
+    ((int) ((sizeof(DirectoryEntry) + (nameLen) + 1 + 3) & ~3))
+					// Record length for a name
+#define MinEntryLength	EntryLength(0)	// Shortest possible record
+#define MaxEntryLength	0xfffc		// Longest (free) record
+
+extern unsigned HashFileName(char *name);
+					// The hash kept with each name
+
+// The following class is the key used to look up directory entries
+// by name in the directory's hash table.  The name's hash is part of
+// the key, so that the names themselves are only compared when the
+// hashes agree.
+
+class FileNameKey {
+  public:
+    FileNameKey(char *n) { name = n; hash = HashFileName(n); }
+    FileNameKey(char *n, unsigned h) { name = n; hash = h; }
+    bool operator==(const FileNameKey &other) const 
+	{ return hash == other.hash && strcmp(name, other.name) == 0; }
+
+    char *name;				// the name being looked up
+    unsigned hash;			// its hash
 };
 
 // The following class defines a UNIX-like "directory".  Each entry in
 // the directory describes a file, and where to find it on disk.
 //
 // The directory data structure can be stored in memory, or on disk.
-// When it is on disk, it is stored as a regular Nachos file.
+// When it is on disk, it is stored as a regular Nachos file, holding
+// the entries exactly as they are laid out in memory.
 //
 // The constructor initializes a directory structure in memory; the
 // FetchFrom/WriteBack operations shuffle the directory information
-// from/to disk. 
+// from/to disk.  An in-memory hash table maps each name in use to its
+// entry, so that looking up a name does not depend on the size of the
+// directory.  The directory remembers what it looks like on disk,
+// so WriteBack only writes the sectors that have changed, and Revert
+// can throw away changes that should not be kept.
+//
+// When there is no free record long enough for a new name, Add doubles
+// the size of the table.  The directory file must then be extended to
+// FileSize() before WriteBack.
 
 class Directory {
   public:
     Directory(int size); 		// Initialize an empty directory
-					// with space for "size" files
+					// taking up "size" bytes
     ~Directory();			// De-allocate the directory
 
     void FetchFrom(OpenFile *file);  	// Init directory contents from disk
     void WriteBack(OpenFile *file);	// Write modifications to 
 					// directory contents back to disk
+    void Revert();			// Undo changes made since the last
+					// FetchFrom or WriteBack
 
     int Find(char *name);		// Find the sector number of the 
 					// FileHeader for file: "name"
+    bool IsDirectory(char *name);	// Is "name" a directory?
 
-    bool Add(char *name, int newSector);  // Add a file name into the directory
+    bool Add(char *name, int newSector, bool isDir);
+					// Add a file name into the directory
 
     bool Remove(char *name);		// Remove a file from the directory
 
+    bool IsEmpty();			// Are there no files in the directory?
+    int FileSize();			// Bytes needed to store the directory
+
     void List();			// Print the names of all the files
-					//  in the directory
+					//  in the directory, and in the
+					//  directories under it
     void Print();			// Verbose print of the contents
 					//  of the directory -- all the file
 					//  names and their contents.
 
   private:
-    int tableSize;			// Number of directory entries
-    DirectoryEntry *table;		// Table of pairs: 
-					// <file name, file header location> 
-
-    int FindIndex(char *name);		// Find the index into the directory 
-					//  table corresponding to "name"
+    int tableSize;			// Number of bytes of entries
+    char *table;			// The entries, one after the other
+    char *diskTable;			// Copy of the table as it is on disk
+    int diskTableSize;			// Number of bytes on disk
+    bool diskTableValid;		// FALSE until the table has been
+					// read from or written to disk
+
+    HashTable<FileNameKey, DirectoryEntry *> *index;
+					// Entries in use, hashed by name
+
+    DirectoryEntry *FindEntry(char *name);
+					// Find the entry for "name"
+    DirectoryEntry *FindSpace(int length);
+					// Find a free record of at least
+					// "length" bytes
+    void MakeFree(int offset, int size);
+					// Turn part of the table into
+					// free records
+    void BuildIndex();			// Hash every entry in use
+    void ClearIndex();			// Empty the hash table
+    void Resize(int size);		// Change the size of the table
+    void ListUnder(char *prefix);	// List, with each name after "prefix"
 };
 
 #endif // DIRECTORY_H
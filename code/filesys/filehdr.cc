@@ -5,10 +5,14 @@
 //	The file header is used to locate where on disk the 
 //	file's data is stored.  We implement this as a fixed size
 //	table of pointers -- each entry in the table points to the 
-//	disk sector containing that portion of the file data
-//	(in other words, there are no indirect or doubly indirect 
-//	blocks). The table size is chosen so that the file header
-//	will be just big enough to fit in one disk sector, 
+//	disk sector containing that portion of the file data -- 
+//	followed by a single indirect and a doubly indirect index block
+//	for larger files.  The table size is chosen so that the file 
+//	header will be just big enough to fit in one disk sector.
+//
+//	To avoid re-reading an index block for every sector of a 
+//	sequential transfer, the header keeps a copy of the index blocks
+//	it used last.
 //
 //      Unlike in a real system, we do not keep track of file permissions, 
 //	ownership, last modification date, etc., in the file header. 
@@ -29,12 +33,73 @@
 #include "synchdisk.h"
 #include "main.h"
 
+//----------------------------------------------------------------------
+// NumIndexSectors
+// 	Return how many index blocks a file with "numSectors" data 
+//	blocks needs, on top of its data blocks.
+//----------------------------------------------------------------------
+
+static int
+NumIndexSectors(int numSectors)
+{
+    int beyond = numSectors - NumDirect - NumIndirect;
+
+    if (numSectors <= NumDirect)
+	return 0;
+    if (beyond <= 0)
+	return 1;				// single indirect only
+    return 2 + divRoundUp(beyond, NumIndirect);	// + doubly indirect, 
+						// + its index blocks
+}
+
+//----------------------------------------------------------------------
+// WriteIndexBlock
+// 	Write out an index block listing "count" sector numbers.  Unused
+//	entries are -1.
+//
+//	"sector" is the disk sector to hold the index block
+//	"entries" are the sector numbers to list
+//	"count" is the number of entries
+//----------------------------------------------------------------------
+
+static void
+WriteIndexBlock(int sector, int *entries, int count)
+{
+    int index[NumIndirect];
+
+    ASSERT(count <= NumIndirect);
+    for (int i = 0; i < NumIndirect; i++)
+	index[i] = (i < count) ? entries[i] : -1;
+    kernel->synchDisk->WriteSector(sector, (char *)index);
+}
+
+//----------------------------------------------------------------------
+// AllocateSector
+// 	Allocate a single sector for an index block.  Going through the
+//	next-fit cursor puts it just after the data blocks allocated last.
+//----------------------------------------------------------------------
+
+static int
+AllocateSector(PersistentBitmap *freeMap)
+{
+    int length;
+    int sector = freeMap->FindAndSetExtent(1, &length);
+
+    ASSERT(sector >= 0);
+    return sector;
+}
+
 //----------------------------------------------------------------------
 // FileHeader::Allocate
 // 	Initialize a fresh file header for a newly created file.
-//	Allocate data blocks for the file out of the map of free disk blocks.
-//	Return FALSE if there are not enough free blocks to accomodate
-//	the new file.
+//	Allocate data blocks for the file out of the map of free disk blocks,
+//	along with any index blocks needed to find them, and write the 
+//	index blocks to disk.  Return FALSE if there are not enough free 
+//	blocks to accomodate the new file.
+//
+//	The data blocks are allocated as a few extents of adjacent 
+//	sectors, rather than one sector at a time, so that reading the 
+//	file sequentially mostly stays on the same track.
 //
 //	"freeMap" is the bit map of free disk sectors
 //	"fileSize" is the bit map of free disk sectors
@@ -43,23 +108,117 @@
 bool
 FileHeader::Allocate(PersistentBitmap *freeMap, int fileSize)
 { 
+    int i, j, start, length, left;
+    int *sectors;
+
     numBytes = fileSize;
     numSectors  = divRoundUp(fileSize, SectorSize);
-    if (freeMap->NumClear() < numSectors)
+    singleIndirect = doubleIndirect = -1;
+    cachedSector[0] = cachedSector[1] = -1;
+    if (numSectors > MaxFileSectors)
+	return FALSE;		// too big for the file header
+    if (freeMap->NumClear() < numSectors + NumIndexSectors(numSectors))
 	return FALSE;		// not enough space
 
-    for (int i = 0; i < numSectors; i++) {
-	dataSectors[i] = freeMap->FindAndSet();
-	// since we checked that there was enough free space,
-	// we expect this to succeed
-	ASSERT(dataSectors[i] >= 0);
+    // since we checked that there was enough free space,
+    // we expect every allocation to succeed
+    sectors = new int[numSectors];
+    for (i = 0; i < numSectors; i += length) {
+	start = freeMap->FindAndSetExtent(numSectors - i, &length);
+	ASSERT(start >= 0);
+	DEBUG(dbgFile, "Allocated extent " << start << " length " << length);
+	for (j = 0; j < length; j++)
+	    sectors[i + j] = start + j;
+    }
+
+    for (i = 0; i < NumDirect; i++)
+	dataSectors[i] = (i < numSectors) ? sectors[i] : -1;
+    i = NumDirect;
+    left = numSectors - NumDirect;
+
+    if (left > 0) {
+	singleIndirect = AllocateSector(freeMap);
+	WriteIndexBlock(singleIndirect, &sectors[i], min(left, NumIndirect));
+	i += NumIndirect;
+	left -= NumIndirect;
     }
+
+    if (left > 0) {
+	int top[NumIndirect];
+	int numLeaves = divRoundUp(left, NumIndirect);
+
+	doubleIndirect = AllocateSector(freeMap);
+	for (j = 0; j < numLeaves; j++) {
+	    top[j] = AllocateSector(freeMap);
+	    WriteIndexBlock(top[j], &sectors[i], min(left, NumIndirect));
+	    i += NumIndirect;
+	    left -= NumIndirect;
+	}
+	WriteIndexBlock(doubleIndirect, top, numLeaves);
+    }
+    delete [] sectors;
     return TRUE;
 }
 
+//----------------------------------------------------------------------
+// FileHeader::Reserve
+// 	Make sure the file has at least "newSectors" data blocks, 
+//	allocating the missing ones, and any index blocks needed to find
+//	them.  The new data blocks are allocated in extents, as by 
+//	Allocate.  The length of the file does not change, so the file
+//	may have more blocks than its length needs (cf. SetLength).
+//	Return FALSE, leaving the file as it was, if there are not enough
+//	free blocks, or the file would be too big.
+//
+//	The header itself is only changed in memory; the caller must
+//	write it back.  Index blocks are written as they change.
+//
+//	"freeMap" is the bit map of free disk sectors
+//	"newSectors" is how many data blocks the file needs
+//----------------------------------------------------------------------
+
+bool
+FileHeader::Reserve(PersistentBitmap *freeMap, int newSectors)
+{
+    int i, j, start, length;
+
+    if (newSectors <= numSectors)
+	return TRUE;			// nothing to do
+    if (newSectors > MaxFileSectors)
+	return FALSE;			// too big for the file header
+    if (freeMap->NumClear() < (newSectors - numSectors) 
+		+ NumIndexSectors(newSectors) - NumIndexSectors(numSectors))
+	return FALSE;			// not enough space
+
+    for (i = numSectors; i < newSectors; i += length) {
+	start = freeMap->FindAndSetExtent(newSectors - i, &length);
+	ASSERT(start >= 0);
+	DEBUG(dbgFile, "Extended by extent " << start << " length " << length);
+	for (j = 0; j < length; j++)
+	    SetSectorOf(freeMap, i + j, start + j);
+    }
+    numSectors = newSectors;
+    return TRUE;
+}
+
+//----------------------------------------------------------------------
+// FileHeader::SetLength
+// 	Change the length of the file to "newSize" bytes.  The file must
+//	already have the data blocks to hold them (cf. Reserve).  As
+//	with Reserve, the caller must write the header back.
+//----------------------------------------------------------------------
+
+void
+FileHeader::SetLength(int newSize)
+{
+    ASSERT(newSize >= 0 && divRoundUp(newSize, SectorSize) <= numSectors);
+    numBytes = newSize;
+}
+
 //----------------------------------------------------------------------
 // FileHeader::Deallocate
-// 	De-allocate all the space allocated for data blocks for this file.
+// 	De-allocate all the space allocated for data blocks for this file,
+//	and for the index blocks pointing to them.
 //
 //	"freeMap" is the bit map of free disk sectors
 //----------------------------------------------------------------------
@@ -67,9 +226,27 @@ FileHeader::Allocate(PersistentBitmap *freeMap, int fileSize)
 void 
 FileHeader::Deallocate(PersistentBitmap *freeMap)
 {
-    for (int i = 0; i < numSectors; i++) {
-	ASSERT(freeMap->Test((int) dataSectors[i]));  // ought to be marked!
-	freeMap->Clear((int) dataSectors[i]);
+    int i, sector;
+
+    for (i = 0; i < numSectors; i++) {
+	sector = SectorOf(i);
+	ASSERT(freeMap->Test(sector));  // ought to be marked!
+	freeMap->Clear(sector);
+    }
+    if (doubleIndirect != -1) {
+	for (i = 0; i < NumIndirect; i++) {
+	    sector = IndexEntry(1, doubleIndirect, i);
+	    if (sector == -1)
+		break;
+	    ASSERT(freeMap->Test(sector));
+	    freeMap->Clear(sector);
+	}
+	ASSERT(freeMap->Test(doubleIndirect));
+	freeMap->Clear(doubleIndirect);
+    }
+    if (singleIndirect != -1) {
+	ASSERT(freeMap->Test(singleIndirect));
+	freeMap->Clear(singleIndirect);
     }
 }
 
@@ -84,6 +261,7 @@ void
 FileHeader::FetchFrom(int sector)
 {
     kernel->synchDisk->ReadSector(sector, (char *)this);
+    cachedSector[0] = cachedSector[1] = -1;	// not read from disk
 }
 
 //----------------------------------------------------------------------
@@ -112,7 +290,132 @@ FileHeader::WriteBack(int sector)
 int
 FileHeader::ByteToSector(int offset)
 {
-    return(dataSectors[offset / SectorSize]);
+    return SectorOf(offset / SectorSize);
+}
+
+//----------------------------------------------------------------------
+// FileHeader::SectorOf
+// 	Return the disk sector storing a given data block of the file,
+//	going through the index blocks if need be.
+//
+//	"which" is the number of the data block within the file
+//----------------------------------------------------------------------
+
+int
+FileHeader::SectorOf(int which)
+{
+    ASSERT(which >= 0 && which < numSectors);
+
+    if (which < NumDirect)
+	return dataSectors[which];
+    which -= NumDirect;
+    if (which < NumIndirect)
+	return IndexEntry(0, singleIndirect, which);
+    which -= NumIndirect;
+    return IndexEntry(0, IndexEntry(1, doubleIndirect, which / NumIndirect),
+			which % NumIndirect);
+}
+
+//----------------------------------------------------------------------
+// FileHeader::IndexEntry
+// 	Return one entry of an index block.  The block is read from disk
+//	only if it is not already the one held in cache slot "slot".
+//
+//	"slot" is the cache slot to use (0 for blocks of data sector
+//		numbers, 1 for the doubly indirect block)
+//	"sector" is the disk sector holding the index block
+//	"which" is the entry wanted
+//----------------------------------------------------------------------
+
+int
+FileHeader::IndexEntry(int slot, int sector, int which)
+{
+    ASSERT(sector >= 0 && which >= 0 && which < NumIndirect);
+
+    if (cachedSector[slot] != sector) {
+	kernel->synchDisk->ReadSector(sector, (char *)cachedIndex[slot]);
+	cachedSector[slot] = sector;
+    }
+    return cachedIndex[slot][which];
+}
+
+//----------------------------------------------------------------------
+// FileHeader::SetSectorOf
+// 	Record the disk sector holding a data block just added to the
+//	file, allocating the index blocks on the way to it if they do not
+//	exist yet.
+//
+//	"freeMap" is the bit map of free disk sectors
+//	"which" is the number of the data block within the file
+//	"sector" is the disk sector holding it
+//----------------------------------------------------------------------
+
+void
+FileHeader::SetSectorOf(PersistentBitmap *freeMap, int which, int sector)
+{
+    int leaf;
+
+    ASSERT(which >= 0 && which < MaxFileSectors);
+
+    if (which < NumDirect) {
+	dataSectors[which] = sector;
+	return;
+    }
+    which -= NumDirect;
+    if (which < NumIndirect) {
+	if (singleIndirect == -1)
+	    singleIndirect = NewIndexBlock(freeMap);
+	SetIndexEntry(0, singleIndirect, which, sector);
+	return;
+    }
+    which -= NumIndirect;
+    if (doubleIndirect == -1)
+	doubleIndirect = NewIndexBlock(freeMap);
+    leaf = IndexEntry(1, doubleIndirect, which / NumIndirect);
+    if (leaf == -1) {
+	leaf = NewIndexBlock(freeMap);
+	SetIndexEntry(1, doubleIndirect, which / NumIndirect, leaf);
+    }
+    SetIndexEntry(0, leaf, which % NumIndirect, sector);
+}
+
+//----------------------------------------------------------------------
+// FileHeader::SetIndexEntry
+// 	Change one entry of an index block, through cache slot "slot",
+//	and write the block back.
+//
+//	"slot" is the cache slot to use (cf. IndexEntry)
+//	"sector" is the disk sector holding the index block
+//	"which" is the entry to change
+//	"value" is its new value
+//----------------------------------------------------------------------
+
+void
+FileHeader::SetIndexEntry(int slot, int sector, int which, int value)
+{
+    (void) IndexEntry(slot, sector, which);	// bring the block in
+    cachedIndex[slot][which] = value;
+    kernel->synchDisk->WriteSector(sector, (char *)cachedIndex[slot]);
+}
+
+//----------------------------------------------------------------------
+// FileHeader::NewIndexBlock
+// 	Allocate an index block with no entries yet, and write it out.
+//	Return its sector.
+//
+//	"freeMap" is the bit map of free disk sectors
+//----------------------------------------------------------------------
+
+int
+FileHeader::NewIndexBlock(PersistentBitmap *freeMap)
+{
+    int sector = AllocateSector(freeMap);
+
+    WriteIndexBlock(sector, NULL, 0);
+    for (int slot = 0; slot < 2; slot++)	// forget any stale copy
+	if (cachedSector[slot] == sector)
+	    cachedSector[slot] = -1;
+    return sector;
 }
 
 //----------------------------------------------------------------------
@@ -140,10 +443,14 @@ FileHeader::Print()
 
     printf("FileHeader contents.  File size: %d.  File blocks:\n", numBytes);
     for (i = 0; i < numSectors; i++)
-	printf("%d ", dataSectors[i]);
+	printf("%d ", SectorOf(i));
+    if (singleIndirect != -1)
+	printf("\nIndirect block: %d", singleIndirect);
+    if (doubleIndirect != -1)
+	printf("\nDoubly indirect block: %d", doubleIndirect);
     printf("\nFile contents:\n");
     for (i = k = 0; i < numSectors; i++) {
-	kernel->synchDisk->ReadSector(dataSectors[i], data);
+	kernel->synchDisk->ReadSector(SectorOf(i), data);
         for (j = 0; (j < SectorSize) && (k < numBytes); j++, k++) {
 	    if ('\040' <= data[j] && data[j] <= '\176')   // isprint(data[j])
 		printf("%c", data[j]);
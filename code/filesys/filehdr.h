@@ -17,19 +17,26 @@
 #include "disk.h"
 #include "pbitmap.h"
 
-#define NumDirect 	((SectorSize - 2 * sizeof(int)) / sizeof(int))
-#define MaxFileSize 	(NumDirect * SectorSize)
+#define NumDirect 	((int) ((SectorSize - 4 * sizeof(int)) / sizeof(int)))
+					// sector numbers in the header itself
+#define NumIndirect	((int) (SectorSize / sizeof(int)))
+					// sector numbers in an index block
+#define MaxFileSectors	(NumDirect + NumIndirect + NumIndirect * NumIndirect)
+#define MaxFileSize 	(MaxFileSectors * SectorSize)
 
 // The following class defines the Nachos "file header" (in UNIX terms,  
 // the "i-node"), describing where on disk to find all of the data in the file.
-// The file header is organized as a simple table of pointers to
-// data blocks. 
+// The file header is organized as a table of pointers to data blocks,
+// as in UNIX: the first NumDirect data sectors are listed in the header
+// itself, the next NumIndirect are listed in a single indirect index
+// block, and the rest go through a doubly indirect index block -- a 
+// block listing further index blocks.
 //
 // The file header data structure can be stored in memory or on disk.
 // When it is on disk, it is stored in a single sector -- this means
-// that we assume the size of this data structure to be the same
-// as one disk sector.  Without indirect addressing, this
-// limits the maximum file length to just under 4K bytes.
+// that we assume the size of the on-disk part of this data structure
+// to be the same as one disk sector.  The in-memory part (a cached
+// copy of the index blocks last used) must therefore come after it.
 //
 // There is no constructor; rather the file header can be initialized
 // by allocating blocks for the file (if it is a new file), or by
@@ -40,6 +47,11 @@ class FileHeader {
     bool Allocate(PersistentBitmap *bitMap, int fileSize);// Initialize a file header, 
 						//  including allocating space 
 						//  on disk for the file data
+    bool Reserve(PersistentBitmap *bitMap, int sectors);
+						// Make sure the file has at least
+						//  "sectors" data blocks on disk
+    void SetLength(int newSize);		// Change the length of the file,
+						//  within the blocks it has
     void Deallocate(PersistentBitmap *bitMap);  // De-allocate this file's 
 						//  data blocks
 
@@ -53,14 +65,43 @@ class FileHeader {
 
     int FileLength();			// Return the length of the file 
 					// in bytes
+    int NumSectors() { return numSectors; }
+					// Return the number of data blocks
+					// allocated to the file
 
     void Print();			// Print the contents of the file.
 
   private:
+    // The following are stored on disk, in the header's own sector
     int numBytes;			// Number of bytes in the file
     int numSectors;			// Number of data sectors in the file
-    int dataSectors[NumDirect];		// Disk sector numbers for each data 
-					// block in the file
+    int dataSectors[NumDirect];		// Disk sector numbers for the first 
+					// NumDirect data blocks in the file
+    int singleIndirect;			// Index block for the next 
+					// NumIndirect data blocks, or -1
+    int doubleIndirect;			// Index block of index blocks for
+					// the rest of the file, or -1
+
+    // The following are only kept in memory
+    int cachedSector[2];		// Index block held in each slot of
+					// cachedIndex, or -1 if none
+    int cachedIndex[2][NumIndirect];	// Copies of the index blocks last
+					// used: slot 0 holds a block of data
+					// sector numbers, slot 1 the 
+					// doubly indirect block
+
+    int SectorOf(int which);		// Disk sector holding the "which"th
+					// data block of the file
+    int IndexEntry(int slot, int sector, int which);
+					// Entry "which" of index block
+					// "sector", via cache slot "slot"
+    void SetSectorOf(PersistentBitmap *freeMap, int which, int sector);
+					// Record where a new data block
+					// is, adding index blocks if need be
+    void SetIndexEntry(int slot, int sector, int which, int value);
+					// Change an entry of an index block
+    int NewIndexBlock(PersistentBitmap *freeMap);
+					// Allocate an empty index block
 };
 
 #endif // FILEHDR_H
@@ -7,34 +7,45 @@
 //		(the size of the file header data structure is arranged
 //		to be precisely the size of 1 disk sector)
 //	   A number of data blocks
-//	   An entry in the file system directory
+//	   An entry in a directory of the file system
 //
 // 	The file system consists of several data structures:
 //	   A bitmap of free disk sectors (cf. bitmap.h)
-//	   A directory of file names and file headers
+//	   A root directory of file names and file headers, some of
+//	     which may be directories in turn
 //
 //      Both the bitmap and the directory are represented as normal
 //	files.  Their file headers are located in specific sectors
-//	(sector 0 and sector 1), so that the file system can find them
-//	on bootup.
+//	(FreeMapSector 1 and DirectorySector 2), so that the file system
+//	can find them on bootup.  Sector 0 holds the superblock, which 
+//	records the geometry of the disk (cf. disk.h).
 //
 //	The file system assumes that the bitmap and directory files are
 //	kept "open" continuously while Nachos is running.
 //
+//	The contents of the bitmap and the root directory are also kept
+//	in memory for as long as Nachos is running, so that looking up a
+//	name does not have to read the directory back from disk.  Other
+//	directories are read in when needed; to save walking the same 
+//	paths over and over, recent lookups are kept in a dentry cache 
+//	(cf. dcache.h).  A lock keeps concurrent file system operations 
+//	from interleaving their changes to these in-memory copies.
+//
 //	For those operations (such as Create, Remove) that modify the
 //	directory and/or bitmap, if the operation succeeds, the changes
-//	are written immediately back to disk (the two files are kept
-//	open during all this time).  If the operation fails, and we have
-//	modified part of the directory and/or bitmap, we simply discard
-//	the changed version, without writing it back to disk.
+//	are written immediately back to disk (only the sectors that were
+//	actually modified are written).  If the operation fails, and we 
+//	have modified part of the directory and/or bitmap, we revert the
+//	in-memory copy to the version on disk.
 //
 // 	Our implementation at this point has the following restrictions:
 //
-//	   there is no synchronization for concurrent accesses
-//	   files have a fixed size, set when the file is created
-//	   files cannot be bigger than about 3KB in size
-//	   there is no hierarchical directory structure, and only a limited
-//	     number of files can be added to the system
+//	   there is no synchronization for concurrent accesses to
+//	     the same file
+//	   files grow when written past the end, but never shrink
+//	   files cannot be bigger than MaxFileSize (cf. filehdr.h)
+//	   there are no "." and ".." entries, nor a current directory:
+//	     every path starts from the root
 //	   there is no attempt to make the system robust to failures
 //	    (if Nachos exits in the middle of an operation that modifies
 //	    the file system, it may corrupt the disk)
@@ -51,19 +62,23 @@
 #include "directory.h"
 #include "filehdr.h"
 #include "filesys.h"
+#include "dcache.h"
+#include "filetable.h"
+#include "synch.h"
+#include "synchdisk.h"
+#include "main.h"
 
 // Sectors containing the file headers for the bitmap of free sectors,
 // and the directory of files.  These file headers are placed in well-known
-// sectors, so that they can be located on boot-up.
-#define FreeMapSector 0
-#define DirectorySector 1
+// sectors, so that they can be located on boot-up.  (Sector 0 holds the 
+// disk's superblock, cf. disk.h.)
+#define FreeMapSector 1
+#define DirectorySector 2
 
-// Initial file sizes for the bitmap and directory; until the file system
-// supports extensible files, the directory size sets the maximum number
-// of files that can be loaded onto the disk.
-#define FreeMapFileSize (NumSectors / BitsInByte)
-#define NumDirEntries 10
-#define DirectoryFileSize (sizeof(DirectoryEntry) * NumDirEntries)
+// Initial file sizes for the bitmap and directories.  A directory file
+// is extended when its table fills up (cf. Directory::Add).
+#define FreeMapFileSize (divRoundUp(NumSectors, BitsInWord) * sizeof(unsigned int))
+#define DirectoryFileSize (2 * SectorSize)
 
 //----------------------------------------------------------------------
 // FileSystem::FileSystem
@@ -73,7 +88,8 @@
 //	not all of the sectors marked as free).
 //
 //	If format = FALSE, we just have to open the files
-//	representing the bitmap and the directory.
+//	representing the bitmap and the directory, and read them into
+//	memory.
 //
 //	"format" -- should we initialize the disk?
 //----------------------------------------------------------------------
@@ -81,17 +97,19 @@
 FileSystem::FileSystem(bool format)
 {
     DEBUG(dbgFile, "Initializing the file system.");
+    CheckSuperBlock();
     if (format)
     {
-        PersistentBitmap *freeMap = new PersistentBitmap(NumSectors);
-        Directory *directory = new Directory(NumDirEntries);
+        freeMap = new PersistentBitmap(NumSectors);
+        directory = new Directory(DirectoryFileSize);
         FileHeader *mapHdr = new FileHeader;
         FileHeader *dirHdr = new FileHeader;
 
         DEBUG(dbgFile, "Formatting the file system.");
 
         // First, allocate space for FileHeaders for the directory and bitmap
-        // (make sure no one else grabs these!)
+        // (make sure no one else grabs these, or the superblock!)
+        freeMap->Mark(SuperBlockSector);
         freeMap->Mark(FreeMapSector);
         freeMap->Mark(DirectorySector);
 
@@ -132,8 +150,6 @@ FileSystem::FileSystem(bool format)
             freeMap->Print();
             directory->Print();
         }
-        delete freeMap;
-        delete directory;
         delete mapHdr;
         delete dirHdr;
     }
@@ -143,82 +159,170 @@ FileSystem::FileSystem(bool format)
         // the bitmap and directory; these are left open while Nachos is running
         freeMapFile = new OpenFile(FreeMapSector);
         directoryFile = new OpenFile(DirectorySector);
+        freeMap = new PersistentBitmap(freeMapFile, NumSectors);
+        directory = new Directory(DirectoryFileSize);
+        directory->FetchFrom(directoryFile);
     }
+    dcache = new DentryCache;
+    lock = new Lock("file system");
+}
+
+//----------------------------------------------------------------------
+// FileSystem::CheckSuperBlock
+// 	Read the superblock, and make sure the disk is the one the file
+//	system is sized for: the free map has a bit for each of the 
+//	disk's sectors, and the on-disk structures fit in one sector.
+//----------------------------------------------------------------------
 
-    openf = new OpenFile*;
-	*openf = NULL;
+void
+FileSystem::CheckSuperBlock()
+{
+    char buffer[SectorSize];
+    SuperBlock *super = (SuperBlock *) buffer;
+
+    kernel->synchDisk->ReadSector(SuperBlockSector, buffer);
+    ASSERT(super->magic == SuperBlockMagic);
+    ASSERT(super->sectorSize == SectorSize);
+    ASSERT(super->sectorsPerTrack * super->numTracks == NumSectors);
+    DEBUG(dbgFile, "Disk of " << super->numTracks << " tracks of " << super->sectorsPerTrack << " sectors.");
+}
+
+//----------------------------------------------------------------------
+// FileSystem::~FileSystem
+// 	De-allocate the in-memory copies of the bitmap and directory, and
+//	close their files.  Every change has already been written back.
+//----------------------------------------------------------------------
+
+FileSystem::~FileSystem()
+{
+    delete lock;
+    delete dcache;
+    delete directory;
+    delete freeMap;
+    delete directoryFile;
+    delete freeMapFile;
 }
 
 //----------------------------------------------------------------------
 // FileSystem::Create
 // 	Create a file in the Nachos file system (similar to UNIX create).
-//	Since we can't increase the size of files dynamically, we have
-//	to give Create the initial size of the file.
+//	Space for "initialSize" bytes is allocated right away; the file
+//	grows beyond that as it is written.
+//
+//	"name" -- path of file to be created
+//	"initialSize" -- size of file to be created
+//----------------------------------------------------------------------
+
+bool FileSystem::Create(char *name, int initialSize)
+{
+    DEBUG(dbgFile, "Creating file " << name << " size " << initialSize);
+    return CreateEntry(name, initialSize, FALSE);
+}
+
+//----------------------------------------------------------------------
+// FileSystem::CreateDirectory
+// 	Create an empty directory in the Nachos file system (similar to
+//	UNIX mkdir).
+//
+//	"name" -- path of directory to be created
+//----------------------------------------------------------------------
+
+bool FileSystem::CreateDirectory(char *name)
+{
+    DEBUG(dbgFile, "Creating directory " << name);
+    return CreateEntry(name, DirectoryFileSize, TRUE);
+}
+
+//----------------------------------------------------------------------
+// FileSystem::CreateEntry
+// 	Create a file or a directory.
 //
 //	The steps to create a file are:
+//	  Find the directory the file goes in, by walking the path
 //	  Make sure the file doesn't already exist
 //        Allocate a sector for the file header
 // 	  Allocate space on disk for the data blocks for the file
-//	  Add the name to the directory
-//	  Store the new file header on disk
+//	  Add the name to the directory, extending the directory file
+//	    if the directory had to grow
+//	  Store the new file header on disk (and for a directory, its 
+//	    empty table)
 //	  Flush the changes to the bitmap and the directory back to disk
 //
 //	Return TRUE if everything goes ok, otherwise, return FALSE.
 //
 // 	Create fails if:
+//		a directory on the path does not exist
 //   		file is already in directory
 //	 	no free space for file header
-//	 	no free entry for file in directory
 //	 	no free space for data blocks for the file
+//	 	no free space to extend the directory
 //
-// 	Note that this implementation assumes there is no concurrent access
-//	to the file system!
-//
-//	"name" -- name of file to be created
+//	"name" -- path of file to be created
 //	"initialSize" -- size of file to be created
+//	"isDir" -- is the file a directory?
 //----------------------------------------------------------------------
 
-bool FileSystem::Create(char *name, int initialSize)
+bool FileSystem::CreateEntry(char *name, int initialSize, bool isDir)
 {
-    Directory *directory;
-    PersistentBitmap *freeMap;
+    char leaf[FileNameMaxLen + 1];
+    Directory *dir;
+    OpenFile *dirFile;
     FileHeader *hdr;
-    int sector;
+    int parent, sector;
     bool success;
 
-    DEBUG(dbgFile, "Creating file " << name << " size " << initialSize);
-
-    directory = new Directory(NumDirEntries);
-    directory->FetchFrom(directoryFile);
-
-    if (directory->Find(name) != -1)
+    lock->Acquire();
+    parent = WalkPath(name, leaf);
+    if (parent == -1)
+    {
+        lock->Release();
+        return FALSE; // no such directory
+    }
+    dir = FetchDirectory(parent, &dirFile);
+    if (dir->Find(leaf) != -1)
         success = FALSE; // file is already in directory
     else
     {
-        freeMap = new PersistentBitmap(freeMapFile, NumSectors);
+        hdr = new FileHeader;
         sector = freeMap->FindAndSet(); // find a sector to hold the file header
         if (sector == -1)
             success = FALSE; // no free block for file header
-        else if (!directory->Add(name, sector))
-            success = FALSE; // no space in directory
+        else if (!hdr->Allocate(freeMap, initialSize))
+            success = FALSE; // no space on disk for data
         else
         {
-            hdr = new FileHeader;
-            if (!hdr->Allocate(freeMap, initialSize))
-                success = FALSE; // no space on disk for data
-            else
+            (void) dir->Add(leaf, sector, isDir);
+            // the whole directory is written back below
+            success = dirFile->Extend(freeMap, dirFile->Length(),
+                                      dir->FileSize());
+        }
+        if (success)
+        {
+            // everthing worked, flush all changes back to disk
+            hdr->WriteBack(sector);
+            if (isDir)
             {
-                success = TRUE;
-                // everthing worked, flush all changes back to disk
-                hdr->WriteBack(sector);
-                directory->WriteBack(directoryFile);
-                freeMap->WriteBack(freeMapFile);
+                OpenFile *file = new OpenFile(sector);
+                Directory *empty = new Directory(DirectoryFileSize);
+
+                empty->WriteBack(file);
+                delete empty;
+                delete file;
             }
-            delete hdr;
+            dir->WriteBack(dirFile);
+            freeMap->WriteBack(freeMapFile);
+            dcache->Enter(parent, leaf, sector, isDir);
         }
-        delete freeMap;
+        else
+        {
+            // throw away any partial changes
+            freeMap->Revert();
+            dir->Revert();
+        }
+        delete hdr;
     }
-    delete directory;
+    ReleaseDirectory(dir, dirFile);
+    lock->Release();
     return success;
 }
 
@@ -226,77 +330,268 @@ bool FileSystem::Create(char *name, int initialSize)
 // FileSystem::Open
 // 	Open a file for reading and writing.
 //	To open a file:
-//	  Find the location of the file's header, using the directory
+//	  Find the location of the file's header, by looking up each
+//	    name on the path in turn
 //	  Bring the header into memory
 //
-//	"name" -- the text name of the file to be opened
+//	Directories cannot be opened this way.
+//
+//	"name" -- the path of the file to be opened
 //----------------------------------------------------------------------
 
 OpenFile *
 FileSystem::Open(char *name)
 {
-    Directory *directory = new Directory(NumDirEntries);
-    
+    char leaf[FileNameMaxLen + 1];
     OpenFile *openFile = NULL;
-    int sector;
+    int parent, sector;
+    bool isDir;
 
     DEBUG(dbgFile, "Opening file" << name);
-    directory->FetchFrom(directoryFile);
-    sector = directory->Find(name);
-    
+    lock->Acquire();
+    parent = WalkPath(name, leaf);
+    if (parent == -1 || !Lookup(parent, leaf, &sector, &isDir) || isDir)
+        sector = -1;
+    lock->Release();
+
     if (sector >= 0)
         openFile = new OpenFile(sector); // name was found in directory
-
-    delete directory;
     return openFile; // return NULL if not found
 }
 
 //----------------------------------------------------------------------
 // FileSystem::Remove
 // 	Delete a file from the file system.  This requires:
-//	    Remove it from the directory
+//	    Remove it from its directory
 //	    Delete the space for its header
 //	    Delete the space for its data blocks
 //	    Write changes to directory, bitmap back to disk
 //
+//	A directory can only be removed once it is empty.
+//
+//	If the file is open, only its name is removed now; its header 
+//	and data blocks are freed when the last OpenFile on it is closed
+//	(cf. FreeRemoved).
+//
 //	Return TRUE if the file was deleted, FALSE if the file wasn't
-//	in the file system.
+//	in the file system, or is a directory that is not empty.
 //
-//	"name" -- the text name of the file to be removed
+//	"name" -- the path of the file to be removed
 //----------------------------------------------------------------------
 
 bool FileSystem::Remove(char *name)
 {
-    Directory *directory;
-    PersistentBitmap *freeMap;
+    char leaf[FileNameMaxLen + 1];
+    Directory *dir;
+    OpenFile *dirFile;
     FileHeader *fileHdr;
-    int sector;
+    int parent, sector;
+    bool isDir;
 
-    directory = new Directory(NumDirEntries);
-    directory->FetchFrom(directoryFile);
-    sector = directory->Find(name);
-    if (sector == -1)
+    lock->Acquire();
+    parent = WalkPath(name, leaf);
+    if (parent == -1 || !Lookup(parent, leaf, &sector, &isDir))
     {
-        delete directory;
+        lock->Release();
         return FALSE; // file not found
     }
-    fileHdr = new FileHeader;
-    fileHdr->FetchFrom(sector);
+    if (isDir)
+    {
+        OpenFile *file = new OpenFile(sector);
+        Directory *victim = new Directory(0);
+        bool empty;
+
+        victim->FetchFrom(file);
+        empty = victim->IsEmpty();
+        delete victim;
+        delete file;
+        if (!empty)
+        {
+            lock->Release();
+            return FALSE; // directory still has files in it
+        }
+    }
+    dir = FetchDirectory(parent, &dirFile);
+    dir->Remove(leaf);
+    dcache->Invalidate(parent, leaf);
+    if (!kernel->openFileTable->Remove(sector))
+    {                                 // not open, so free it now
+        fileHdr = new FileHeader;
+        fileHdr->FetchFrom(sector);
+        fileHdr->Deallocate(freeMap); // remove data blocks
+        freeMap->Clear(sector);       // remove header block
+        freeMap->WriteBack(freeMapFile); // flush to disk
+        delete fileHdr;
+    }
 
-    freeMap = new PersistentBitmap(freeMapFile, NumSectors);
+    dir->WriteBack(dirFile);         // flush to disk
+    ReleaseDirectory(dir, dirFile);
+    lock->Release();
+    return TRUE;
+}
 
-    fileHdr->Deallocate(freeMap); // remove data blocks
-    freeMap->Clear(sector);       // remove header block
-    directory->Remove(name);
+//----------------------------------------------------------------------
+// FileSystem::FreeRemoved
+// 	Free the header and data blocks of a file that was removed while
+//	it was open, now that the last OpenFile on it has been closed.
+//	Called by the open file table.
+//
+//	"sector" -- the location on disk of the file header
+//	"hdr" -- the file's header
+//----------------------------------------------------------------------
 
-    freeMap->WriteBack(freeMapFile);     // flush to disk
-    directory->WriteBack(directoryFile); // flush to disk
-    delete fileHdr;
-    delete directory;
-    delete freeMap;
+void
+FileSystem::FreeRemoved(int sector, FileHeader *hdr)
+{
+    lock->Acquire();
+    hdr->Deallocate(freeMap);        // remove data blocks
+    freeMap->Clear(sector);          // remove header block
+    freeMap->WriteBack(freeMapFile); // flush to disk
+    lock->Release();
+}
+
+//----------------------------------------------------------------------
+// FileSystem::Extend
+// 	Make an open file "newSize" bytes long, allocating more disk 
+//	space for it (cf. OpenFile::Extend), and write the free map back.
+//	Return FALSE if there is not enough space on disk.  Called by
+//	OpenFile when a write goes past the end of the file.
+//
+//	"file" -- the file to extend
+//	"position" -- where the write that needs the space starts
+//	"newSize" -- the new length of the file
+//----------------------------------------------------------------------
+
+bool
+FileSystem::Extend(OpenFile *file, int position, int newSize)
+{
+    bool success;
+
+    lock->Acquire();
+    success = file->Extend(freeMap, position, newSize);
+    if (success)
+        freeMap->WriteBack(freeMapFile);
+    else
+        freeMap->Revert();
+    lock->Release();
+    return success;
+}
+
+//----------------------------------------------------------------------
+// FileSystem::WalkPath
+// 	Look up every name on a path but the last, each in the directory
+//	named before it, starting from the root.  Return the header 
+//	sector of the directory the last name should be found in, and
+//	copy that name into "leaf".  Return -1 if the path is empty, or
+//	one of the directories on it does not exist.
+//
+//	A name longer than FileNameMaxLen cannot be in any directory, so
+//	a path with one is treated like a path through a missing directory.
+//
+//	"name" -- the path to walk
+//	"leaf" -- where to put the last name (FileNameMaxLen + 1 bytes)
+//----------------------------------------------------------------------
+
+int
+FileSystem::WalkPath(char *name, char *leaf)
+{
+    int dirSector = DirectorySector;
+    int sector, length;
+    bool isDir;
+
+    for (;;) {
+        while (*name == '/')
+            name++;
+        for (length = 0; name[length] != '/' && name[length] != '\0'; length++)
+            ;
+        if (length == 0 || length > FileNameMaxLen)
+            return -1; // path names no file, or name is too long
+        strncpy(leaf, name, length);
+        leaf[length] = '\0';
+        name += length;
+        while (*name == '/')
+            name++;
+        if (*name == '\0')
+            return dirSector; // "leaf" is the last name
+        if (!Lookup(dirSector, leaf, &sector, &isDir) || !isDir)
+            return -1;
+        dirSector = sector;
+    }
+}
+
+//----------------------------------------------------------------------
+// FileSystem::Lookup
+// 	Look up "name" in the directory whose header is at "dirSector".
+//	Return TRUE, with the file's header sector and whether it is a
+//	directory, if it is there.  The dentry cache is tried first; 
+//	only if it misses is the directory brought in from disk.
+//
+//	"dirSector" -- the header sector of the directory
+//	"name" -- the name to look up
+//	"sector", "isDir" -- where to return the result
+//----------------------------------------------------------------------
+
+bool
+FileSystem::Lookup(int dirSector, char *name, int *sector, bool *isDir)
+{
+    Directory *dir;
+    OpenFile *dirFile;
+
+    if (dcache->Lookup(dirSector, name, sector, isDir))
+        return TRUE;
+
+    dir = FetchDirectory(dirSector, &dirFile);
+    *sector = dir->Find(name);
+    *isDir = dir->IsDirectory(name);
+    ReleaseDirectory(dir, dirFile);
+    if (*sector == -1)
+        return FALSE;
+    dcache->Enter(dirSector, name, *sector, *isDir);
     return TRUE;
 }
 
+//----------------------------------------------------------------------
+// FileSystem::FetchDirectory
+// 	Return an in-memory copy of the directory whose header is at
+//	"sector", and (in "file") the directory file, open.  The root
+//	directory is always in memory; any other is read from disk.
+//	Must be matched by a call to ReleaseDirectory.
+//
+//	"sector" -- the header sector of the directory
+//	"file" -- where to return the open directory file
+//----------------------------------------------------------------------
+
+Directory *
+FileSystem::FetchDirectory(int sector, OpenFile **file)
+{
+    Directory *dir;
+
+    if (sector == DirectorySector)
+    {
+        *file = directoryFile;
+        return directory;
+    }
+    *file = new OpenFile(sector);
+    dir = new Directory(0);
+    dir->FetchFrom(*file);
+    return dir;
+}
+
+//----------------------------------------------------------------------
+// FileSystem::ReleaseDirectory
+// 	Let go of a directory returned by FetchDirectory.  Changes to it
+//	must already have been written back.
+//----------------------------------------------------------------------
+
+void
+FileSystem::ReleaseDirectory(Directory *dir, OpenFile *file)
+{
+    if (dir == directory)
+        return; // the root stays in memory
+    delete dir;
+    delete file;
+}
+
 //----------------------------------------------------------------------
 // FileSystem::List
 // 	List all the files in the file system directory.
@@ -304,11 +599,9 @@ bool FileSystem::Remove(char *name)
 
 void FileSystem::List()
 {
-    Directory *directory = new Directory(NumDirEntries);
-
-    directory->FetchFrom(directoryFile);
+    lock->Acquire();
     directory->List();
-    delete directory;
+    lock->Release();
 }
 
 //----------------------------------------------------------------------
@@ -325,9 +618,8 @@ void FileSystem::Print()
 {
     FileHeader *bitHdr = new FileHeader;
     FileHeader *dirHdr = new FileHeader;
-    PersistentBitmap *freeMap = new PersistentBitmap(freeMapFile, NumSectors);
-    Directory *directory = new Directory(NumDirEntries);
 
+    lock->Acquire();
     printf("Bit map file header:\n");
     bitHdr->FetchFrom(FreeMapSector);
     bitHdr->Print();
@@ -338,13 +630,11 @@ void FileSystem::Print()
 
     freeMap->Print();
 
-    directory->FetchFrom(directoryFile);
     directory->Print();
+    lock->Release();
 
     delete bitHdr;
     delete dirHdr;
-    delete freeMap;
-    delete directory;
 }
 
 #endif // FILESYS_STUB
@@ -18,10 +18,10 @@
 //	file system (in a file named "DISK"). 
 //
 //	In the "real" implementation, there are two key data structures used 
-//	in the file system.  There is a single "root" directory, listing
-//	all of the files in the file system; unlike UNIX, the baseline
-//	system does not provide a hierarchical directory structure.  
-//	In addition, there is a bitmap for allocating
+//	in the file system.  There is a "root" directory, at the top of a
+//	tree of directories as in UNIX; files are named by their path
+//	from the root, such as "/usr/bin/ls" (the leading '/' may be
+//	left out).  In addition, there is a bitmap for allocating
 //	disk sectors.  Both the root directory and the bitmap are themselves
 //	stored as files in the Nachos file system -- this causes an interesting
 //	bootstrap problem when the simulated disk is initialized. 
@@ -42,12 +42,7 @@
 				// implementation is available
 class FileSystem {
   public:
-  	OpenFile** openf;
-    FileSystem() {
-		openf = new OpenFile*;
-		*openf = NULL;
-		
-	}
+    FileSystem() {}
 
     bool Create(char *name) {
 	int fileDescriptor = OpenForWrite(name);
@@ -71,24 +66,39 @@ class FileSystem {
 };
 
 #else // FILESYS
+class PersistentBitmap;
+class Directory;
+class FileHeader;
+class DentryCache;
+class Lock;
+
 class FileSystem {
   public:
-
-	OpenFile** openf;
-
     FileSystem(bool format);		// Initialize the file system.
 					// Must be called *after* "synchDisk" 
 					// has been initialized.
     					// If "format", there is nothing on
 					// the disk, so initialize the directory
     					// and the bitmap of free blocks.
+    ~FileSystem();			// De-allocate the file system
 
     bool Create(char *name, int initialSize);  	
 					// Create a file (UNIX creat)
 
+    bool CreateDirectory(char *name);	// Create a directory (UNIX mkdir)
+
     OpenFile* Open(char *name); 	// Open a file (UNIX open)
 
-    bool Remove(char *name);  		// Delete a file (UNIX unlink)
+    bool Remove(char *name);  		// Delete a file or an empty
+					// directory (UNIX unlink, rmdir)
+
+    bool Extend(OpenFile *file, int position, int newSize);
+					// Allocate space for an open file
+					// to grow to "newSize" bytes, for
+					// a write at "position"
+    void FreeRemoved(int sector, FileHeader *hdr);
+					// Free the space of a file removed
+					// while it was open
 
     void List();			// List all the files in the file system
 
@@ -99,6 +109,26 @@ class FileSystem {
 					// represented as a file
    OpenFile* directoryFile;		// "Root" directory -- list of 
 					// file names, represented as a file
+   PersistentBitmap *freeMap;		// In-memory copy of the free map
+   Directory *directory;		// In-memory copy of the root directory
+   DentryCache *dcache;			// Recent name lookups
+   Lock *lock;				// Protects freeMap, directory and
+					// dcache
+
+   void CheckSuperBlock();		// Make sure the disk's geometry is
+					// what the file system expects
+
+   bool CreateEntry(char *name, int initialSize, bool isDir);
+					// Create a file or directory
+   int WalkPath(char *name, char *leaf);
+					// Find the directory holding the
+					// last name on a path
+   bool Lookup(int dirSector, char *name, int *sector, bool *isDir);
+					// Look up a name in a directory
+   Directory *FetchDirectory(int sector, OpenFile **file);
+   void ReleaseDirectory(Directory *dir, OpenFile *file);
+					// Bring a directory into memory,
+					// and let go of it
 };
 
 #endif // FILESYS
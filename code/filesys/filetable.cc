@@ -0,0 +1,150 @@
+// filetable.cc
+//	Routines to manage the system-wide table of open files.  See
+//	filetable.h.
+//
+// Copyright (c) 1992-1993 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#ifndef FILESYS_STUB
+
+#include "copyright.h"
+#include "debug.h"
+#include "filehdr.h"
+#include "filetable.h"
+#include "synch.h"
+#include "main.h"
+
+//----------------------------------------------------------------------
+// EntrySector, HashSector
+// 	Routines used by the table's hash table -- to get the key of an
+//	entry (its header sector), and to hash a key.
+//----------------------------------------------------------------------
+
+static int
+EntrySector(OpenFileEntry *entry)
+{
+    return entry->sector;
+}
+
+static unsigned
+HashSector(int sector)
+{
+    return (unsigned) sector * 2654435761u;
+}
+
+//----------------------------------------------------------------------
+// OpenFileTable::OpenFileTable
+// 	Initialize an empty table of open files.
+//----------------------------------------------------------------------
+
+OpenFileTable::OpenFileTable()
+{
+    files = new HashTable<int, OpenFileEntry *>(EntrySector, HashSector);
+    lock = new Lock("open file table");
+}
+
+//----------------------------------------------------------------------
+// OpenFileTable::~OpenFileTable
+// 	De-allocate the table.  Files still open when Nachos halts are
+//	not closed.
+//----------------------------------------------------------------------
+
+OpenFileTable::~OpenFileTable()
+{
+    delete lock;
+    delete files;
+}
+
+//----------------------------------------------------------------------
+// OpenFileTable::Open
+// 	Return the entry for the file whose header is at "sector", and
+//	count one more OpenFile using it.  If the file is not open yet,
+//	make an entry for it, and read in its header.
+//
+//	"sector" -- the location on disk of the file header
+//----------------------------------------------------------------------
+
+OpenFileEntry *
+OpenFileTable::Open(int sector)
+{
+    OpenFileEntry *entry;
+
+    lock->Acquire();
+    if (!files->Find(sector, &entry)) {
+	DEBUG(dbgFile, "Reading in the header at sector " << sector);
+	entry = new OpenFileEntry;
+	entry->sector = sector;
+	entry->hdr = new FileHeader;
+	entry->hdr->FetchFrom(sector);
+	entry->lock = new Lock("open file");
+	entry->refCount = 0;
+	entry->removed = FALSE;
+	files->Insert(entry);
+    }
+    entry->refCount++;
+    lock->Release();
+    return entry;
+}
+
+//----------------------------------------------------------------------
+// OpenFileTable::Close
+// 	Count one less OpenFile using "entry".  When none are left, the
+//	file is no longer open: remove its entry, and the in-memory copy
+//	of its header.  (The header on disk is kept up to date as the
+//	file changes, so nothing needs to be written back.)  If the file
+//	was removed while it was open, its disk space is freed now.
+//
+//	"entry" -- an entry returned by Open
+//----------------------------------------------------------------------
+
+void
+OpenFileTable::Close(OpenFileEntry *entry)
+{
+    bool last;
+
+    lock->Acquire();
+    ASSERT(entry->refCount > 0);
+    last = (--entry->refCount == 0);
+    if (last && !entry->removed)
+	(void) files->Remove(entry->sector);
+    lock->Release();
+
+    if (!last)
+	return;
+    if (entry->removed)		// nobody else can find the entry now
+	kernel->fileSystem->FreeRemoved(entry->sector, entry->hdr);
+    delete entry->lock;
+    delete entry->hdr;
+    delete entry;
+}
+
+//----------------------------------------------------------------------
+// OpenFileTable::Remove
+// 	Called when the file whose header is at "sector" is removed from
+//	the file system.  If the file is not open, return FALSE: the 
+//	caller can free its disk space right away.  Otherwise, take its
+//	entry out of the table, so that later Opens don't find it, and
+//	mark it to be freed by the last Close; return TRUE.
+//
+//	"sector" -- the location on disk of the file header
+//----------------------------------------------------------------------
+
+bool
+OpenFileTable::Remove(int sector)
+{
+    OpenFileEntry *entry;
+    bool open;
+
+    lock->Acquire();
+    open = files->Find(sector, &entry);
+    if (open) {
+	DEBUG(dbgFile, "Header at sector " << sector << " removed while open");
+	(void) files->Remove(sector);
+	entry->removed = TRUE;
+    }
+    lock->Release();
+    return open;
+}
+
+#endif // FILESYS_STUB
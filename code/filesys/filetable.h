@@ -0,0 +1,70 @@
+// filetable.h
+//	Data structures for the system-wide table of open files.
+//
+//	Every OpenFile refers to a file by the sector holding its header.
+//	However many times a file is open, by however many threads, its
+//	header is only in memory once: the table keeps one copy for each
+//	open file, along with a count of the OpenFiles using it, and a
+//	lock to keep them from changing the header at the same time.
+//	Opening a file that is already open costs no disk access; the
+//	header goes away when the last OpenFile on it is closed.
+//
+//	A file removed while it is open is taken out of the table at
+//	once, so that a new file given the same header sector cannot be
+//	mistaken for it.  Its disk space is only freed when the last
+//	OpenFile on it is closed; until then, it can still be read and 
+//	written.
+//
+//	In contrast, fdtable.h (in userprog) is a per-process table
+//	of file descriptors, each naming an OpenFile.
+//
+// Copyright (c) 1992-1993 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#ifndef FILETABLE_H
+#define FILETABLE_H
+
+#include "copyright.h"
+#include "hash.h"
+
+class FileHeader;
+class Lock;
+
+// The following class defines an entry in the open file table: the
+// in-memory header of one open file, shared by all the OpenFiles on it.
+
+class OpenFileEntry {
+  public:
+    int sector;				// Disk sector holding the header
+    FileHeader *hdr;			// The file's header
+    Lock *lock;				// Held while the file is being
+					// read or written
+    int refCount;			// Number of OpenFiles using it
+    bool removed;			// Has the file been removed?  If
+					// so, it is no longer in the table
+};
+
+class OpenFileTable {
+  public:
+    OpenFileTable();			// Initialize an empty table
+    ~OpenFileTable();			// De-allocate the table
+
+    OpenFileEntry *Open(int sector);	// Return the entry for the file
+					// whose header is at "sector",
+					// reading the header in if the file
+					// is not open yet
+    void Close(OpenFileEntry *entry);	// Let go of an entry; the last
+					// OpenFile to do so removes it
+    bool Remove(int sector);		// The file whose header is at 
+					// "sector" is being removed; TRUE if
+					// it is open, and must be freed by
+					// the last Close
+
+  private:
+    HashTable<int, OpenFileEntry *> *files;	// Entries, by header sector
+    Lock *lock;				// Protects "files" and the
+					// reference counts
+};
+
+#endif // FILETABLE_H
@@ -16,21 +16,29 @@
 #include "main.h"
 #include "filehdr.h"
 #include "openfile.h"
+#include "filesys.h"
+#include "filetable.h"
 #include "synchdisk.h"
 
 //----------------------------------------------------------------------
 // OpenFile::OpenFile
-// 	Open a Nachos file for reading and writing.  Bring the file header
-//	into memory while the file is open.
+// 	Open a Nachos file for reading and writing.  The file header is
+//	kept in memory while the file is open (cf. OpenFileTable), and 
+//	is only read in if the file was not open already.
 //
 //	"sector" -- the location on disk of the file header for this file
 //----------------------------------------------------------------------
 
 OpenFile::OpenFile(int sector)
 { 
-    hdr = new FileHeader;
-    hdr->FetchFrom(sector);
+    shared = kernel->openFileTable->Open(sector);
+    hdr = shared->hdr;
+    hdrSector = sector;
     seekPosition = 0;
+    lastReadEnd = 0;
+    readAheadWindow = 0;
+    readAheadMark = 0;
+    readAheadNext = 0;
 }
 
 //----------------------------------------------------------------------
@@ -40,7 +48,7 @@ OpenFile::OpenFile(int sector)
 
 OpenFile::~OpenFile()
 {
-    delete hdr;
+    kernel->openFileTable->Close(shared);
 }
 
 //----------------------------------------------------------------------
@@ -94,30 +102,56 @@ OpenFile::Write(char *into, int numBytes)
 //
 //	There is no guarantee the request starts or ends on an even disk sector
 //	boundary; however the disk only knows how to read/write a whole disk
-//	sector at a time.  Thus:
+//	sector at a time.  Thus the request is split into up to three parts:
 //
-//	For ReadAt:
-//	   We read in all of the full or partial sectors that are part of the
-//	   request, but we only copy the part we are interested in.
-//	For WriteAt:
-//	   We must first read in any sectors that will be partially written,
-//	   so that we don't overwrite the unmodified portion.  We then copy
-//	   in the data that will be modified, and write back all the full
-//	   or partial sectors that are part of the request.
+//	   the sectors wholly inside the request, which are transferred
+//	   straight to/from the caller's buffer, one disk request per 
+//	   run of sectors that are adjacent on disk;
+//
+//	   a partial sector at either end, which goes through a one-sector
+//	   buffer on the stack.  For ReadAt, we read in the sector and copy 
+//	   the part we are interested in.  For WriteAt, we must first read 
+//	   in the sector, so that we don't overwrite the unmodified portion,
+//	   then copy in the data that will be modified, and write it back.
 //
 //	"into" -- the buffer to contain the data to be read from disk 
 //	"from" -- the buffer containing the data to be written to disk 
 //	"numBytes" -- the number of bytes to transfer
 //	"position" -- the offset within the file of the first byte to be
 //			read/written
+//
+//	The file's lock is held throughout, since the header (and the
+//	index blocks it caches) is shared with other OpenFiles.
 //----------------------------------------------------------------------
 
 int
 OpenFile::ReadAt(char *into, int numBytes, int position)
+{
+    int result;
+
+    shared->lock->Acquire();
+    result = ReadAtLocked(into, numBytes, position);
+    shared->lock->Release();
+    return result;
+}
+
+int
+OpenFile::WriteAt(char *from, int numBytes, int position)
+{
+    int result;
+
+    shared->lock->Acquire();
+    result = WriteAtLocked(from, numBytes, position);
+    shared->lock->Release();
+    return result;
+}
+
+int
+OpenFile::ReadAtLocked(char *into, int numBytes, int position)
 {
     int fileLength = hdr->FileLength();
-    int i, firstSector, lastSector, numSectors;
-    char *buf;
+    int i, n, end, firstFull, lastFull, lastSector;
+    char sector[SectorSize];
 
     if ((numBytes <= 0) || (position >= fileLength))
     	return 0; 				// check request
@@ -125,61 +159,280 @@ OpenFile::ReadAt(char *into, int numBytes, int position)
 	numBytes = fileLength - position;
     DEBUG(dbgFile, "Reading " << numBytes << " bytes at " << position << " from file of length " << fileLength);
 
-    firstSector = divRoundDown(position, SectorSize);
-    lastSector = divRoundDown(position + numBytes - 1, SectorSize);
-    numSectors = 1 + lastSector - firstSector;
+    end = position + numBytes;
+    firstFull = divRoundUp(position, SectorSize);
+    lastFull = divRoundDown(end, SectorSize) - 1;
+    lastSector = divRoundDown(end - 1, SectorSize);
+
+    // partial sector at the front (which may also be the end)
+    if ((position % SectorSize) != 0) {
+	n = min(numBytes, firstFull * SectorSize - position);
+	kernel->synchDisk->ReadSector(hdr->ByteToSector(position), sector);
+	bcopy(&sector[position % SectorSize], into, n);
+    }
+
+    // whole sectors
+    for (i = firstFull; i <= lastFull; i += n) {
+	n = RunLength(i, lastFull);
+        kernel->synchDisk->ReadSectors(hdr->ByteToSector(i * SectorSize), n,
+					&into[i * SectorSize - position]);
+    }
 
-    // read in all the full and partial sectors that we need
-    buf = new char[numSectors * SectorSize];
-    for (i = firstSector; i <= lastSector; i++)	
-        kernel->synchDisk->ReadSector(hdr->ByteToSector(i * SectorSize), 
-					&buf[(i - firstSector) * SectorSize]);
+    // partial sector at the back
+    if (((end % SectorSize) != 0) && (lastSector >= firstFull)) {
+	kernel->synchDisk->ReadSector(hdr->ByteToSector(lastSector * SectorSize),
+					sector);
+	bcopy(sector, &into[lastSector * SectorSize - position], 
+					end - lastSector * SectorSize);
+    }
 
-    // copy the part we want
-    bcopy(&buf[position - (firstSector * SectorSize)], into, numBytes);
-    delete [] buf;
+    ReadAhead(position, numBytes);
     return numBytes;
 }
 
 int
-OpenFile::WriteAt(char *from, int numBytes, int position)
+OpenFile::WriteAtLocked(char *from, int numBytes, int position)
 {
     int fileLength = hdr->FileLength();
-    int i, firstSector, lastSector, numSectors;
-    bool firstAligned, lastAligned;
-    char *buf;
+    int i, n, end, firstFull, lastFull, lastSector, diskSector;
+    char sector[SectorSize];
 
-    if ((numBytes <= 0) || (position >= fileLength))
+    if (numBytes <= 0)
 	return 0;				// check request
-    if ((position + numBytes) > fileLength)
-	numBytes = fileLength - position;
+    if ((position + numBytes) > fileLength) {	// write past the end
+	if (Grow(position, position + numBytes))
+	    fileLength = position + numBytes;
+	else if (position >= fileLength)
+	    return 0;				// no room on disk
+	else
+	    numBytes = fileLength - position;
+    }
     DEBUG(dbgFile, "Writing " << numBytes << " bytes at " << position << " from file of length " << fileLength);
 
-    firstSector = divRoundDown(position, SectorSize);
-    lastSector = divRoundDown(position + numBytes - 1, SectorSize);
-    numSectors = 1 + lastSector - firstSector;
+    end = position + numBytes;
+    firstFull = divRoundUp(position, SectorSize);
+    lastFull = divRoundDown(end, SectorSize) - 1;
+    lastSector = divRoundDown(end - 1, SectorSize);
 
-    buf = new char[numSectors * SectorSize];
+    // partial sector at the front (which may also be the end):
+    // read it in (directly, so as not to disturb the reader's 
+    // read-ahead), modify, and write back
+    if ((position % SectorSize) != 0) {
+	n = min(numBytes, firstFull * SectorSize - position);
+	diskSector = hdr->ByteToSector(position);
+	kernel->synchDisk->ReadSector(diskSector, sector);
+	bcopy(from, &sector[position % SectorSize], n);
+	kernel->synchDisk->WriteSector(diskSector, sector);
+    }
 
-    firstAligned = (position == (firstSector * SectorSize));
-    lastAligned = ((position + numBytes) == ((lastSector + 1) * SectorSize));
+    // whole sectors
+    for (i = firstFull; i <= lastFull; i += n) {
+	n = RunLength(i, lastFull);
+        kernel->synchDisk->WriteSectors(hdr->ByteToSector(i * SectorSize), n,
+					&from[i * SectorSize - position]);
+    }
 
-// read in first and last sector, if they are to be partially modified
-    if (!firstAligned)
-        ReadAt(buf, SectorSize, firstSector * SectorSize);	
-    if (!lastAligned && ((firstSector != lastSector) || firstAligned))
-        ReadAt(&buf[(lastSector - firstSector) * SectorSize], 
-				SectorSize, lastSector * SectorSize);	
+    // partial sector at the back
+    if (((end % SectorSize) != 0) && (lastSector >= firstFull)) {
+	diskSector = hdr->ByteToSector(lastSector * SectorSize);
+	kernel->synchDisk->ReadSector(diskSector, sector);
+	bcopy(&from[lastSector * SectorSize - position], sector, 
+					end - lastSector * SectorSize);
+	kernel->synchDisk->WriteSector(diskSector, sector);
+    }
+    return numBytes;
+}
 
-// copy in the bytes we want to change 
-    bcopy(from, &buf[position - (firstSector * SectorSize)], numBytes);
+//----------------------------------------------------------------------
+// OpenFile::RunLength
+// 	Return how many of the file's sectors, starting at "from" and
+//	going no further than "to", are stored in adjacent disk sectors,
+//	so that they can be transferred as one disk request.
+//
+//	"from", "to" -- sector numbers within the file
+//----------------------------------------------------------------------
 
-// write modified sectors back
-    for (i = firstSector; i <= lastSector; i++)	
-        kernel->synchDisk->WriteSector(hdr->ByteToSector(i * SectorSize), 
-					&buf[(i - firstSector) * SectorSize]);
-    delete [] buf;
-    return numBytes;
+int
+OpenFile::RunLength(int from, int to)
+{
+    int first = hdr->ByteToSector(from * SectorSize);
+    int n = 1;
+
+    while ((from + n <= to) 
+		&& (hdr->ByteToSector((from + n) * SectorSize) == first + n))
+	n++;
+    return n;
+}
+
+//----------------------------------------------------------------------
+// OpenFile::ReadAhead
+// 	Called after each read.  If the read carried on from where the
+//	previous one ended, and has reached the start of the last batch 
+//	read ahead, ask the disk for the next batch, doubling the window
+//	(up to MaxReadAhead).  A full-size batch is cut short at the end
+//	of the track it starts on, so that once the file is being read a 
+//	track at a time, each batch is exactly one track.  Any other read
+//	starts the pattern over.
+//
+//	"position", "numBytes" -- the read just done
+//----------------------------------------------------------------------
+
+void
+OpenFile::ReadAhead(int position, int numBytes)
+{
+    int lastSector = divRoundDown(position + numBytes - 1, SectorSize);
+    int fileSectors = divRoundUp(hdr->FileLength(), SectorSize);
+    int i, n, from, to, diskSector;
+    bool sequential = (position == lastReadEnd);
+
+    lastReadEnd = position + numBytes;
+    if (!sequential) {
+	readAheadWindow = 0;
+	readAheadMark = readAheadNext = lastSector + 1;
+	return;
+    }
+    if (lastSector < readAheadMark)
+	return;				// still working on the last batch
+
+    if (readAheadWindow == 0)
+	readAheadWindow = MinReadAhead;
+    else
+	readAheadWindow = min(2 * readAheadWindow, MaxReadAhead);
+    from = max(readAheadNext, lastSector + 1);
+    to = min(from + readAheadWindow, fileSectors) - 1;
+    if (from > to)
+	return;				// nothing left to read
+    if (readAheadWindow == MaxReadAhead) {
+	diskSector = hdr->ByteToSector(from * SectorSize);
+	to = min(to, from + SectorsPerTrack - diskSector % SectorsPerTrack - 1);
+    }
+
+    DEBUG(dbgFile, "Reading ahead sectors " << from << " to " << to);
+    for (i = from; i <= to; i += n) {
+	n = RunLength(i, to);
+	kernel->synchDisk->ReadAhead(hdr->ByteToSector(i * SectorSize), n);
+    }
+    readAheadMark = from;
+    readAheadNext = to + 1;
+}
+
+//----------------------------------------------------------------------
+// OpenFile::Flush
+// 	Make sure everything written to the file is on disk.  Writes 
+//	normally stay in the disk cache until the flusher gets to them;
+//	for simplicity, this writes back the whole cache, which also
+//	covers the file header and the free map.
+//----------------------------------------------------------------------
+
+void
+OpenFile::Flush()
+{
+    kernel->synchDisk->Flush();
+}
+
+//----------------------------------------------------------------------
+// OpenFile::Grow
+// 	Make the file "newSize" bytes long, so that a write past the end
+//	of the file can go ahead.  If the file already has the data blocks,
+//	only the length in the header changes; otherwise, the file system
+//	has to allocate more (cf. FileSystem::Extend).  Return FALSE if 
+//	there is not enough space on disk.
+//
+//	The bytes between the old end of the file and the start of the 
+//	write are cleared first, so that nothing left on disk by an 
+//	earlier file can be read back.
+//
+//	"position" -- where the write starts
+//	"newSize" -- the new length of the file
+//----------------------------------------------------------------------
+
+bool
+OpenFile::Grow(int position, int newSize)
+{
+    DEBUG(dbgFile, "Growing file from " << hdr->FileLength() << " to " << newSize);
+    if (!HasRoomFor(newSize))
+	return kernel->fileSystem->Extend(this, position, newSize);
+    Clear(hdr->FileLength(), position);
+    hdr->SetLength(newSize);
+    hdr->WriteBack(hdrSector);
+    return TRUE;
+}
+
+//----------------------------------------------------------------------
+// OpenFile::Clear
+// 	Write zeroes over the bytes of the file from "from" up to (but
+//	not including) "to".  The file must have the data blocks for them,
+//	but they may lie past its end.
+//----------------------------------------------------------------------
+
+void
+OpenFile::Clear(int from, int to)
+{
+    char sector[SectorSize];
+    int n, diskSector;
+
+    for (; from < to; from += n) {
+	n = min(to - from, SectorSize - from % SectorSize);
+	diskSector = hdr->ByteToSector(from);
+	if (n < SectorSize)		// keep the rest of the sector
+	    kernel->synchDisk->ReadSector(diskSector, sector);
+	bzero(&sector[from % SectorSize], n);
+	kernel->synchDisk->WriteSector(diskSector, sector);
+    }
+}
+
+//----------------------------------------------------------------------
+// OpenFile::HasRoomFor
+// 	Return TRUE if the file has the data blocks to be "newSize" bytes
+//	long, so that it can grow to that size without the free map.
+//----------------------------------------------------------------------
+
+bool
+OpenFile::HasRoomFor(int newSize)
+{
+    return divRoundUp(newSize, SectorSize) <= hdr->NumSectors();
+}
+
+//----------------------------------------------------------------------
+// OpenFile::Extend
+// 	Make the file at least "newSize" bytes long, allocating the extra
+//	space out of "freeMap", and write the header back.  Return FALSE, 
+//	leaving the file as it was, if there is not enough space.  The
+//	caller is responsible for writing back the free map.
+//
+//	Blocks are allocated in batches: beyond the blocks "newSize" 
+//	needs, as many again as the file already has (at least 
+//	MinGrowSectors, at most MaxGrowSectors), if there is room for 
+//	them.  The file can then keep growing for a while without 
+//	touching the free map.
+//
+//	As in Grow, the bytes between the old end of the file and 
+//	"position", where the caller is about to write, are cleared.
+//	The caller writes the rest, up to "newSize".  Blocks reserved 
+//	past "newSize" are not cleared: they lie past the end of the 
+//	file, and Grow clears what a later write skips over.
+//
+//	"freeMap" -- the bit map of free disk sectors
+//	"position" -- where the caller's write starts
+//	"newSize" -- the new length of the file
+//----------------------------------------------------------------------
+
+bool
+OpenFile::Extend(PersistentBitmap *freeMap, int position, int newSize)
+{
+    int needed = divRoundUp(newSize, SectorSize);
+    int batch = min(max(hdr->NumSectors(), MinGrowSectors), MaxGrowSectors);
+
+    if (newSize <= hdr->FileLength())
+	return TRUE;			// nothing to do
+    if (!HasRoomFor(newSize) 
+		&& !hdr->Reserve(freeMap, min(needed + batch, MaxFileSectors))
+		&& !hdr->Reserve(freeMap, needed))
+	return FALSE;
+    Clear(hdr->FileLength(), position);
+    hdr->SetLength(newSize);
+    hdr->WriteBack(hdrSector);
+    return TRUE;
 }
 
 //----------------------------------------------------------------------
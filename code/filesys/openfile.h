@@ -51,6 +51,8 @@ class OpenFile {
 		currentOffset += numWritten;
 		return numWritten;
 		}
+    void Seek(int position) { currentOffset = position; }
+    void Flush() { }			// UNIX writes are already through
 
     int Length() { Lseek(file, 0, 2); return Tell(file); }
     
@@ -61,6 +63,37 @@ class OpenFile {
 
 #else // FILESYS
 class FileHeader;
+class OpenFileEntry;
+class PersistentBitmap;
+
+#define MinReadAhead	4		// sectors read ahead once a file is
+					// seen being read sequentially
+#define MaxReadAhead	(min(SectorsPerTrack, NumCacheSectors / 2))
+					// the read-ahead window doubles on
+					// each batch, up to a whole track
+					// (or as much as the cache can take)
+
+#define MinGrowSectors	4		// blocks added to a growing file
+#define MaxGrowSectors	(SectorsPerTrack)
+					// beyond what a write needs; the
+					// batch doubles with the file, up
+					// to a track
+
+// A write past the end of a file makes the file longer.  New data blocks
+// are allocated in batches (cf. Extend), so a file that is appended to a
+// little at a time only goes to the free map once in a while; writes 
+// into blocks already allocated just change the length in the header.
+
+// Sequential reads are detected per open file: a read that starts where
+// the previous one ended.  When the reader reaches the start of the 
+// last batch read ahead, the next batch is asked for (asynchronously,
+// see SynchDisk::ReadAhead), twice as big as the one before.  A 
+// byte-at-a-time reader thus ends up costing one disk request per track.
+
+// Every OpenFile on the same file shares one in-memory copy of its 
+// header (cf. filetable.h).  Reads and writes hold the file's lock, so
+// that one OpenFile's changes to the header -- as the file grows -- are 
+// seen whole by all the others.
 
 class OpenFile {
   public:
@@ -82,14 +115,51 @@ class OpenFile {
 					// bypassing the implicit position.
     int WriteAt(char *from, int numBytes, int position);
 
+    void Flush();			// Write any of the file's data still
+					// in the disk cache through to disk
+
+    bool Extend(PersistentBitmap *freeMap, int position, int newSize);
+					// Make the file "newSize" bytes long,
+					// for a write at "position",
+					// allocating space from "freeMap";
+					// the caller must hold the file's 
+					// lock, or the file system's
+
     int Length(); 			// Return the number of bytes in the
 					// file (this interface is simpler 
 					// than the UNIX idiom -- lseek to 
 					// end of file, tell, lseek back 
     
   private:
-    FileHeader *hdr;			// Header for this file 
+    OpenFileEntry *shared;		// The file's entry in the open
+					// file table
+    FileHeader *hdr;			// Header for this file (shared)
+    int hdrSector;			// Disk sector holding the header
     int seekPosition;			// Current position within the file
+
+    int lastReadEnd;			// Where the previous read ended
+    int readAheadWindow;		// Size of the last read-ahead batch,
+					// or 0 if reads are not sequential
+    int readAheadMark;			// Reaching this sector of the file
+					// triggers the next batch
+    int readAheadNext;			// First sector of the file not 
+					// yet read ahead
+
+    int ReadAtLocked(char *into, int numBytes, int position);
+    int WriteAtLocked(char *from, int numBytes, int position);
+					// ReadAt/WriteAt, with the file's
+					// lock held
+    bool Grow(int position, int newSize);
+					// Make the file longer, for a write
+					// at "position"
+    void Clear(int from, int to);	// Write zeroes over part of the file
+    bool HasRoomFor(int newSize);	// Could the file be "newSize" bytes
+					// long without allocating space?
+    int RunLength(int from, int to);	// How many sectors from "from" on
+					// are adjacent on disk?
+    void ReadAhead(int position, int numBytes);
+					// Note a read, and read ahead if
+					// the file is being read sequentially
 };
 
 #endif // FILESYS
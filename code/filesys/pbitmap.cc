@@ -7,7 +7,9 @@
 // of liability and disclaimer of warranty provisions.
 
 #include "copyright.h"
+#include "debug.h"
 #include "pbitmap.h"
+#include "disk.h"
 
 //----------------------------------------------------------------------
 // PersistentBitmap::PersistentBitmap(int)
@@ -21,6 +23,9 @@
 
 PersistentBitmap::PersistentBitmap(int numItems):Bitmap(numItems) 
 { 
+    diskMap = new unsigned int[numWords];
+    diskMapValid = FALSE;
+    cursor = 0;
 }
 
 //----------------------------------------------------------------------
@@ -40,7 +45,9 @@ PersistentBitmap::PersistentBitmap(OpenFile *file, int numItems):Bitmap(numItems
     // map has already been initialized by the BitMap constructor,
     // but we will just overwrite that with the contents of the
     // map found in the file
-    file->ReadAt((char *)map, numWords * sizeof(unsigned), 0);
+    diskMap = new unsigned int[numWords];
+    cursor = 0;
+    FetchFrom(file);
 }
 
 //----------------------------------------------------------------------
@@ -50,6 +57,7 @@ PersistentBitmap::PersistentBitmap(OpenFile *file, int numItems):Bitmap(numItems
 
 PersistentBitmap::~PersistentBitmap()
 { 
+    delete [] diskMap;
 }
 
 //----------------------------------------------------------------------
@@ -63,11 +71,16 @@ void
 PersistentBitmap::FetchFrom(OpenFile *file) 
 {
     file->ReadAt((char *)map, numWords * sizeof(unsigned), 0);
+    bcopy((char *)map, (char *)diskMap, numWords * sizeof(unsigned));
+    diskMapValid = TRUE;
+    RecountClear();
 }
 
 //----------------------------------------------------------------------
 // PersistentBitmap::WriteBack
 // 	Store the contents of a persistent bitmap to a Nachos file.
+//	Only the sectors of the file that differ from what is already
+//	on disk are written.
 //
 //	"file" is the place to write the bitmap to
 //----------------------------------------------------------------------
@@ -75,5 +88,68 @@ PersistentBitmap::FetchFrom(OpenFile *file)
 void
 PersistentBitmap::WriteBack(OpenFile *file)
 {
-   file->WriteAt((char *)map, numWords * sizeof(unsigned), 0);
+    int numBytes = numWords * sizeof(unsigned);
+    char *now = (char *) map;
+    char *onDisk = (char *) diskMap;
+
+    for (int offset = 0; offset < numBytes; offset += SectorSize) {
+	int chunk = min(SectorSize, numBytes - offset);
+	if (!diskMapValid || memcmp(&now[offset], &onDisk[offset], chunk) != 0)
+	    file->WriteAt(&now[offset], chunk, offset);
+    }
+    bcopy(now, onDisk, numBytes);
+    diskMapValid = TRUE;
+}
+
+//----------------------------------------------------------------------
+// PersistentBitmap::Revert
+// 	Throw away any changes made since the bitmap was last read from
+//	or written to disk.
+//----------------------------------------------------------------------
+
+void
+PersistentBitmap::Revert()
+{
+    ASSERT(diskMapValid);
+    bcopy((char *)diskMap, (char *)map, numWords * sizeof(unsigned));
+    RecountClear();
+}
+
+//----------------------------------------------------------------------
+// PersistentBitmap::FindAndSetExtent
+// 	Allocate a run of adjacent clear bits, of length "wanted" if 
+//	possible.  The search is next-fit: it starts where the previous 
+//	extent ended, and wraps around to the beginning of the bitmap.
+//	If no run is long enough, the longest one found is used instead,
+//	and the caller should ask again for the rest.
+//
+//	Return the first bit of the extent (with its length in "*length"),
+//	or -1 if no bits are clear.
+//
+//	"wanted" is the number of bits the caller would like
+//	"length" is where to return the number of bits allocated
+//----------------------------------------------------------------------
+
+int
+PersistentBitmap::FindAndSetExtent(int wanted, int *length)
+{
+    int start, len, wrapStart, wrapLen;
+
+    ASSERT(wanted > 0);
+    start = FindClearRun(cursor, numBits, wanted, &len);
+    if (len < wanted) {				// try before the cursor
+	wrapStart = FindClearRun(0, cursor, wanted, &wrapLen);
+	if (wrapLen > len) {
+	    start = wrapStart;
+	    len = wrapLen;
+	}
+    }
+    *length = len;
+    if (len == 0)
+	return -1;				// bitmap is full
+
+    for (int i = start; i < start + len; i++)
+	Mark(i);
+    cursor = (start + len) % numBits;
+    return start;
 }
@@ -6,6 +6,14 @@
 //    when it is created, or it can be initialized later using
 //    the FetchFrom method
 //
+//    Disk sectors can also be allocated in extents -- runs of adjacent
+//    sectors -- using a next-fit cursor, so that the blocks of a file 
+//    end up next to each other on disk.
+//
+//    The bitmap remembers what it looks like on disk, so that WriteBack
+//    only writes the sectors that have changed, and Revert can throw
+//    away changes that should not be kept.
+//
 // Copyright (c) 1992,1993,1995 The Regents of the University of California.
 // All rights reserved.  See copyright.h for copyright notice and limitation 
 // of liability and disclaimer of warranty provisions.
@@ -29,7 +37,22 @@ class PersistentBitmap : public Bitmap {
     ~PersistentBitmap(); 			// deallocate bitmap
 
     void FetchFrom(OpenFile *file);     // read bitmap from the disk
-    void WriteBack(OpenFile *file); 	// write bitmap contents to disk 
+    void WriteBack(OpenFile *file); 	// write changed parts of the 
+					// bitmap contents to disk 
+    void Revert();			// undo changes made since the last
+					// FetchFrom or WriteBack
+
+    int FindAndSetExtent(int wanted, int *length);
+					// allocate a run of up to "wanted"
+					// adjacent bits; return its start
+					// and length, or -1 if none are clear
+
+  private:
+    int cursor;				// where the next extent search starts
+
+    unsigned int *diskMap;		// copy of the bitmap as it is on disk
+    bool diskMapValid;			// FALSE until the bitmap has been
+					// read from or written to disk
 };
 
 #endif // PBITMAP_H
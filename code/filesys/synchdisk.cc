@@ -6,9 +6,29 @@
 //	the request completes).
 //
 //	Use a semaphore to synchronize the interrupt handlers with the
-//	pending requests.  And, because the physical disk can only
-//	handle one operation at a time, use a lock to enforce mutual
-//	exclusion.
+//	pending requests.  Because the physical disk can only handle one 
+//	operation at a time, requests that arrive while it is busy wait
+//	in a queue; each time the disk finishes, the interrupt handler 
+//	picks the next request according to the scheduling policy and 
+//	starts it.
+//
+//	Recently used sectors are kept in a write-back buffer cache, so
+//	that hot sectors (file headers, directory and bitmap sectors, and
+//	the partial sectors read back by OpenFile::WriteAt) come from
+//	memory instead of costing a full disk latency each time.  A lock
+//	protects the cache, but it is released while a thread waits for
+//	the disk, so that other threads can queue requests of their own.
+//	A cache slot with I/O in progress is marked busy; anyone else who
+//	wants it waits until the I/O finishes.
+//
+//	Read-ahead can't be done by the disk interrupt handler, because 
+//	filling the cache needs the lock.  Instead, ReadAhead queues the
+//	sectors for a worker thread, which reads them just as a waiting
+//	thread would, and then goes back for more.
+//
+//	Write-behind works the same way the other way round: a flusher 
+//	thread sleeps on a semaphore, which the timer interrupt (through
+//	Tick) or a writer that finds too many dirty sectors V's.
 //
 // Copyright (c) 1992-1993 The Regents of the University of California.
 // All rights reserved.  See copyright.h for copyright notice and limitation 
@@ -16,39 +36,98 @@
 
 #include "copyright.h"
 #include "synchdisk.h"
+#include "debug.h"
+#include "main.h"
+
+//----------------------------------------------------------------------
+// DiskRequest::DiskRequest
+// 	Initialize a request to transfer "n" adjacent sectors, starting
+//	at "first", to or from "buffer".
+//----------------------------------------------------------------------
+
+DiskRequest::DiskRequest(int first, int n, char *buffer, bool write)
+{
+    firstSector = first;
+    count = n;
+    data = buffer;
+    writing = write;
+    done = new Semaphore("disk request", 0);
+}
 
+DiskRequest::~DiskRequest()
+{
+    delete done;
+}
 
 //----------------------------------------------------------------------
 // SynchDisk::SynchDisk
 // 	Initialize the synchronous interface to the physical disk, in turn
 //	initializing the physical disk.
 //
+//	"diskPolicy" -- how to choose among queued requests
 //----------------------------------------------------------------------
 
-SynchDisk::SynchDisk()
+SynchDisk::SynchDisk(DiskPolicy diskPolicy)
 {
-    semaphore = new Semaphore("synch disk", 0);
     lock = new Lock("synch disk lock");
+    slotReady = new Condition("synch disk slot ready");
     disk = new Disk(this);
+
+    policy = diskPolicy;
+    pending = new List<DiskRequest *>;
+    active = NULL;
+
+    readAhead = new List<DiskRequest *>;
+    readAheadWanted = new Condition("synch disk read-ahead wanted");
+    readAheadThread = NULL;
+
+    numDirty = 0;
+    flushWanted = new Semaphore("synch disk flush wanted", 0);
+    flushPosted = FALSE;
+    lastFlush = 0;
+    flushThread = NULL;
+
+    cache = new CacheEntry[NumCacheSectors];
+    cacheSlot = new int[NumSectors];
+    for (int i = 0; i < NumSectors; i++)
+	cacheSlot[i] = -1;
+    for (int slot = 0; slot < NumCacheSectors; slot++) {
+	cache[slot].sector = -1;
+	cache[slot].dirty = FALSE;
+	cache[slot].busy = FALSE;
+	cache[slot].prev = slot - 1;
+	cache[slot].next = (slot + 1 < NumCacheSectors) ? slot + 1 : -1;
+    }
+    lruHead = 0;
+    lruTail = NumCacheSectors - 1;
 }
 
 //----------------------------------------------------------------------
 // SynchDisk::~SynchDisk
 // 	De-allocate data structures needed for the synchronous disk
-//	abstraction.
+//	abstraction.  The cache must already have been flushed (see
+//	Interrupt::Halt); at this point the interrupt system is gone.
+//
+//	As with the postal worker, the read-ahead thread may be waiting on
+//	"readAheadWanted", and the flusher on "flushWanted", so we don't 
+//	deallocate the lock, the condition, the semaphore, or the 
+//	read-ahead queue.
 //----------------------------------------------------------------------
 
 SynchDisk::~SynchDisk()
 {
+    delete [] cache;
+    delete [] cacheSlot;
+    delete pending;
     delete disk;
-    delete lock;
-    delete semaphore;
+    delete slotReady;
 }
 
 //----------------------------------------------------------------------
 // SynchDisk::ReadSector
 // 	Read the contents of a disk sector into a buffer.  Return only
-//	after the data has been read.
+//	after the data has been read.  If the sector is in the cache, 
+//	no disk request is needed.
 //
 //	"sectorNumber" -- the disk sector to read
 //	"data" -- the buffer to hold the contents of the disk sector
@@ -57,16 +136,19 @@ SynchDisk::~SynchDisk()
 void
 SynchDisk::ReadSector(int sectorNumber, char* data)
 {
-    lock->Acquire();			// only one disk I/O at a time
-    disk->ReadRequest(sectorNumber, data);
-    semaphore->P();			// wait for interrupt
+    int slot;
+
+    lock->Acquire();
+    slot = GetSlot(sectorNumber, TRUE);
+    bcopy(cache[slot].data, data, SectorSize);
     lock->Release();
 }
 
 //----------------------------------------------------------------------
 // SynchDisk::WriteSector
-// 	Write the contents of a buffer into a disk sector.  Return only
-//	after the data has been written.
+// 	Write the contents of a buffer into a disk sector.  The new
+//	contents go into the cache, and reach the disk when the sector
+//	is evicted or the cache is flushed.
 //
 //	"sectorNumber" -- the disk sector to be written
 //	"data" -- the new contents of the disk sector
@@ -75,20 +157,616 @@ SynchDisk::ReadSector(int sectorNumber, char* data)
 void
 SynchDisk::WriteSector(int sectorNumber, char* data)
 {
-    lock->Acquire();			// only one disk I/O at a time
-    disk->WriteRequest(sectorNumber, data);
-    semaphore->P();			// wait for interrupt
+    int slot;
+
+    lock->Acquire();
+    slot = GetSlot(sectorNumber, FALSE);	// whole sector is overwritten,
+					// so no need to read it first
+    bcopy(data, cache[slot].data, SectorSize);
+    MarkDirty(slot);
     lock->Release();
 }
 
+//----------------------------------------------------------------------
+// SynchDisk::ReadSectors
+// 	Read the contents of "count" adjacent disk sectors into a buffer.
+//	Return only after all the data has been read.
+//
+//	"firstSector" -- the first disk sector to read
+//	"count" -- the number of sectors
+//	"data" -- the buffer to hold the contents (count * SectorSize bytes)
+//----------------------------------------------------------------------
+
+void
+SynchDisk::ReadSectors(int firstSector, int count, char* data)
+{
+    ASSERT((firstSector >= 0) && (count > 0) 
+		&& (firstSector + count <= NumSectors));
+
+    lock->Acquire();
+    Fetch(firstSector, count, data, FALSE);
+    lock->Release();
+}
+
+//----------------------------------------------------------------------
+// SynchDisk::ReadAhead
+// 	Ask for "count" adjacent disk sectors to be read into the cache,
+//	and return right away.  The read-ahead thread reads the sectors 
+//	that are not already cached, one request per run of them.
+//
+//	"firstSector" -- the first disk sector wanted
+//	"count" -- the number of sectors (no more than half the cache)
+//----------------------------------------------------------------------
+
+void
+SynchDisk::ReadAhead(int firstSector, int count)
+{
+    ASSERT((firstSector >= 0) && (count > 0) 
+		&& (firstSector + count <= NumSectors));
+    ASSERT(count <= NumCacheSectors / 2);
+
+    lock->Acquire();
+    if (readAheadThread == NULL) {
+	readAheadThread = new Thread("read-ahead");
+	readAheadThread->Fork(SynchDisk::ReadAheadWorker, this);
+    }
+    readAhead->Append(new DiskRequest(firstSector, count, NULL, FALSE));
+    readAheadWanted->Signal(lock);
+    lock->Release();
+}
+
+//----------------------------------------------------------------------
+// SynchDisk::ReadAheadWorker
+// 	Wait for ReadAhead requests, and bring their sectors into the
+//	cache.
+//----------------------------------------------------------------------
+
+void
+SynchDisk::ReadAheadWorker(void *data)
+{
+    SynchDisk *_this = (SynchDisk *) data;
+    char *buffer = new char[NumCacheSectors * SectorSize];
+    DiskRequest *request;
+
+    _this->lock->Acquire();
+    for (;;) {
+	while (_this->readAhead->IsEmpty())
+	    _this->readAheadWanted->Wait(_this->lock);
+	request = _this->readAhead->RemoveFront();
+	_this->Fetch(request->firstSector, request->count, buffer, TRUE);
+	delete request;
+    }
+}
+
+//----------------------------------------------------------------------
+// SynchDisk::Fetch
+// 	Bring "count" adjacent disk sectors into the cache, and copy 
+//	them into "data".  Sectors in the cache are copied from there; 
+//	each run of sectors that are not cached is read from disk as a 
+//	single request, into cache slots claimed (and marked busy) 
+//	beforehand.  Caller must hold the lock; it is released while 
+//	waiting for the disk.
+//
+//	For read-ahead ("hint"), sectors already cached or on their way
+//	are skipped, and "data" is only scratch space for the reads.
+//	Read-ahead never waits for a slot, nor writes one back to make
+//	room: if no clean slot is free, the rest of the hint is dropped.
+//
+//	"firstSector" -- the first disk sector to read
+//	"count" -- the number of sectors
+//	"data" -- the buffer to hold the contents (count * SectorSize bytes)
+//	"hint" -- is this read-ahead?
+//----------------------------------------------------------------------
+
+void
+SynchDisk::Fetch(int firstSector, int count, char* data, bool hint)
+{
+    int i, j, n, sector, slot;
+    int claimed[NumCacheSectors];
+
+    ASSERT(lock->IsHeldByCurrentThread());
+
+    i = 0;
+    while (i < count) {
+	sector = firstSector + i;
+	slot = cacheSlot[sector];
+	if ((slot != -1) && hint) {		// nothing to do
+	    i++;
+	    continue;
+	}
+	if (slot != -1) {
+	    if (cache[slot].busy) {		// wait for its I/O, and
+		slotReady->Wait(lock);		// then look again
+		continue;
+	    }
+	    kernel->stats->numCacheHits++;	// cached -- copy it out
+	    MoveToFront(slot);
+	    bcopy(cache[slot].data, &data[i * SectorSize], SectorSize);
+	    i++;
+	    continue;
+	}
+
+	// claim clean slots for the run of uncached sectors that follows
+	for (n = 0; (i + n < count) && (cacheSlot[sector + n] == -1); n++) {
+	    slot = FindVictim();
+	    if ((slot == -1) || cache[slot].dirty)
+		break;
+	    TakeSlot(slot, sector + n);
+	    cache[slot].busy = TRUE;
+	    claimed[n] = slot;
+	}
+	if ((n == 0) && hint)		// no room: forget the rest
+	    return;
+	if (n == 0) {			// no clean slot to be had: make one
+	    slot = FindVictim();
+	    if (slot == -1)
+		slotReady->Wait(lock);
+	    else
+		WriteBackSlot(slot);
+	    continue;			// the lock was released; look again
+	}
+
+	// read the whole run in one request
+	DiskRead(sector, n, &data[i * SectorSize]);
+	for (j = 0; j < n; j++) {
+	    if (hint)
+		kernel->stats->numCacheReadAheads++;
+	    else
+		kernel->stats->numCacheMisses++;
+	    bcopy(&data[(i + j) * SectorSize], cache[claimed[j]].data, SectorSize);
+	    cache[claimed[j]].busy = FALSE;
+	}
+	slotReady->Broadcast(lock);
+	i += n;
+    }
+}
+
+//----------------------------------------------------------------------
+// SynchDisk::WriteSectors
+// 	Write the contents of a buffer into "count" adjacent disk sectors.
+//	As with WriteSector, the new contents go into the cache; Flush
+//	later writes adjacent dirty sectors back together.
+//
+//	"firstSector" -- the first disk sector to be written
+//	"count" -- the number of sectors
+//	"data" -- the new contents (count * SectorSize bytes)
+//----------------------------------------------------------------------
+
+void
+SynchDisk::WriteSectors(int firstSector, int count, char* data)
+{
+    int slot;
+
+    ASSERT((firstSector >= 0) && (count > 0) 
+		&& (firstSector + count <= NumSectors));
+
+    lock->Acquire();
+    for (int i = 0; i < count; i++) {
+	slot = GetSlot(firstSector + i, FALSE);
+	bcopy(&data[i * SectorSize], cache[slot].data, SectorSize);
+	MarkDirty(slot);
+    }
+    lock->Release();
+}
+
+//----------------------------------------------------------------------
+// SynchDisk::Flush
+// 	Write every dirty sector in the cache back to disk.  The sectors
+//	stay cached (now clean).  Runs of adjacent dirty sectors are 
+//	written as a single request.  Return only after all the data has
+//	been written.
+//----------------------------------------------------------------------
+
+void
+SynchDisk::Flush()
+{
+    int n, slot;
+    int claimed[NumCacheSectors];
+    char *buffer = new char[NumCacheSectors * SectorSize];
+    int sector = 0;
+
+    lock->Acquire();
+    while (sector < NumSectors) {
+	slot = cacheSlot[sector];
+	if ((slot == -1) || !cache[slot].dirty) {
+	    sector++;
+	    continue;
+	}
+	if (cache[slot].busy) {		// already being written back
+	    slotReady->Wait(lock);
+	    continue;
+	}
+
+	// gather the run of adjacent dirty sectors
+	for (n = 0; sector + n < NumSectors; n++) {
+	    slot = cacheSlot[sector + n];
+	    if ((slot == -1) || !cache[slot].dirty || cache[slot].busy)
+		break;
+	    cache[slot].busy = TRUE;
+	    bcopy(cache[slot].data, &buffer[n * SectorSize], SectorSize);
+	    claimed[n] = slot;
+	}
+	DiskWrite(sector, n, buffer);
+	for (int i = 0; i < n; i++) {
+	    cache[claimed[i]].busy = FALSE;
+	    MarkClean(claimed[i]);
+	}
+	slotReady->Broadcast(lock);
+	sector += n;
+    }
+    lock->Release();
+    delete [] buffer;
+}
+
+//----------------------------------------------------------------------
+// SynchDisk::Tick
+// 	Called from the timer interrupt handler.  If dirty sectors have 
+//	been waiting since the flusher last ran more than FlushTicks 
+//	ago, wake it up.  Interrupts are already disabled.
+//----------------------------------------------------------------------
+
+void
+SynchDisk::Tick()
+{
+    if ((numDirty > 0) 
+		&& (kernel->stats->totalTicks - lastFlush >= FlushTicks))
+	WakeFlusher();
+}
+
+//----------------------------------------------------------------------
+// SynchDisk::MarkDirty/MarkClean
+// 	Keep track of how many cache slots are dirty.  Marking the first
+//	sector dirty starts the flusher thread; once DirtyThreshold 
+//	sectors are dirty, the flusher is woken without waiting for the 
+//	timer.  Caller must hold the lock.
+//
+//	"slot" -- the cache slot just written/written back
+//----------------------------------------------------------------------
+
+void
+SynchDisk::MarkDirty(int slot)
+{
+    if (cache[slot].dirty)
+	return;
+    cache[slot].dirty = TRUE;
+    numDirty++;
+
+    if (flushThread == NULL) {
+	lastFlush = kernel->stats->totalTicks;
+	flushThread = new Thread("flusher");
+	flushThread->Fork(SynchDisk::FlushWorker, this);
+    }
+    if (numDirty >= DirtyThreshold)
+	WakeFlusher();
+}
+
+void
+SynchDisk::MarkClean(int slot)
+{
+    ASSERT(cache[slot].dirty);
+    cache[slot].dirty = FALSE;
+    numDirty--;
+}
+
+//----------------------------------------------------------------------
+// SynchDisk::WakeFlusher
+// 	V the flusher's semaphore, unless that has been done already
+//	and the flusher has not yet got round to it.
+//----------------------------------------------------------------------
+
+void
+SynchDisk::WakeFlusher()
+{
+    IntStatus oldLevel = kernel->interrupt->SetLevel(IntOff);
+
+    if (!flushPosted) {
+	flushPosted = TRUE;
+	flushWanted->V();
+    }
+    (void) kernel->interrupt->SetLevel(oldLevel);
+}
+
+//----------------------------------------------------------------------
+// SynchDisk::FlushWorker
+// 	Wait to be woken, then write every dirty sector back to disk, 
+//	runs of adjacent sectors coalesced into single requests by Flush.
+//----------------------------------------------------------------------
+
+void
+SynchDisk::FlushWorker(void *data)
+{
+    SynchDisk *_this = (SynchDisk *) data;
+
+    for (;;) {
+	_this->flushWanted->P();
+	_this->flushPosted = FALSE;	// anything dirtied from now on
+					// needs another pass
+	DEBUG(dbgDisk, "Flusher writing " << _this->numDirty << " dirty sectors");
+	_this->Flush();
+	_this->lastFlush = kernel->stats->totalTicks;
+    }
+}
+
+//----------------------------------------------------------------------
+// SynchDisk::GetSlot
+// 	Return the cache slot holding "sectorNumber", making it the most
+//	recently used.  On a miss, the least recently used slot that is 
+//	not busy is taken over, writing its old contents back first if 
+//	they are dirty.  Caller must hold the lock; it may be released 
+//	and re-acquired in the meantime, while waiting for the disk.
+//
+//	"sectorNumber" -- the disk sector wanted
+//	"fetch" -- on a miss, read the sector from disk?  (FALSE when
+//		the caller is about to overwrite the whole sector)
+//----------------------------------------------------------------------
+
+int
+SynchDisk::GetSlot(int sectorNumber, bool fetch)
+{
+    int slot;
+
+    ASSERT((sectorNumber >= 0) && (sectorNumber < NumSectors));
+    ASSERT(lock->IsHeldByCurrentThread());
+
+    for (;;) {
+	slot = cacheSlot[sectorNumber];
+	if (slot != -1) {
+	    if (cache[slot].busy) {	// wait for its I/O to finish
+		slotReady->Wait(lock);
+		continue;
+	    }
+	    kernel->stats->numCacheHits++;
+	    MoveToFront(slot);
+	    return slot;
+	}
+
+	slot = FindVictim();
+	if (slot == -1) {		// every slot is busy
+	    slotReady->Wait(lock);
+	    continue;
+	}
+	if (cache[slot].dirty) {	// clean it first; as the lock is
+	    WriteBackSlot(slot);	// released meanwhile, start over
+	    continue;
+	}
+
+	kernel->stats->numCacheMisses++;
+	TakeSlot(slot, sectorNumber);
+	if (fetch) {
+	    cache[slot].busy = TRUE;
+	    DiskRead(sectorNumber, 1, cache[slot].data);
+	    cache[slot].busy = FALSE;
+	    slotReady->Broadcast(lock);
+	}
+	return slot;
+    }
+}
+
+//----------------------------------------------------------------------
+// SynchDisk::FindVictim
+// 	Return the least recently used cache slot that is not busy, or -1
+//	if every slot has I/O in progress.
+//----------------------------------------------------------------------
+
+int
+SynchDisk::FindVictim()
+{
+    int slot = lruTail;
+
+    while ((slot != -1) && cache[slot].busy)
+	slot = cache[slot].prev;
+    return slot;
+}
+
+//----------------------------------------------------------------------
+// SynchDisk::TakeSlot
+// 	Reassign a clean cache slot to "sectorNumber", which must not
+//	already be cached, evicting the sector it held before.  The slot
+//	becomes the most recently used; its data must be filled in by
+//	the caller.
+//
+//	"slot" -- the cache slot to reuse
+//	"sectorNumber" -- the disk sector to be cached
+//----------------------------------------------------------------------
+
+void
+SynchDisk::TakeSlot(int slot, int sectorNumber)
+{
+    ASSERT(!cache[slot].busy && !cache[slot].dirty);
+    ASSERT(cacheSlot[sectorNumber] == -1);
+
+    if (cache[slot].sector != -1) {	// evict the old sector
+	DEBUG(dbgDisk, "Cache evicting sector " << cache[slot].sector);
+	kernel->stats->numCacheEvictions++;
+	cacheSlot[cache[slot].sector] = -1;
+    }
+    cache[slot].sector = sectorNumber;
+    cacheSlot[sectorNumber] = slot;
+    MoveToFront(slot);
+}
+
+//----------------------------------------------------------------------
+// SynchDisk::WriteBackSlot
+// 	Write a dirty cache slot back to disk, leaving it clean.  The slot
+//	is busy meanwhile, so no one else touches its data.
+//
+//	"slot" -- the cache slot to clean
+//----------------------------------------------------------------------
+
+void
+SynchDisk::WriteBackSlot(int slot)
+{
+    ASSERT(cache[slot].dirty && !cache[slot].busy);
+
+    cache[slot].busy = TRUE;
+    DiskWrite(cache[slot].sector, 1, cache[slot].data);
+    cache[slot].busy = FALSE;
+    MarkClean(slot);
+    slotReady->Broadcast(lock);
+}
+
+//----------------------------------------------------------------------
+// SynchDisk::MoveToFront
+// 	Unlink a slot from the LRU list and put it back at the head,
+//	as the most recently used slot.
+//
+//	"slot" -- the cache slot just used
+//----------------------------------------------------------------------
+
+void
+SynchDisk::MoveToFront(int slot)
+{
+    CacheEntry *entry = &cache[slot];
+
+    if (slot == lruHead)
+	return;
+
+    // unlink -- slot is not the head, so it has a predecessor
+    cache[entry->prev].next = entry->next;
+    if (entry->next != -1)
+	cache[entry->next].prev = entry->prev;
+    else
+	lruTail = entry->prev;
+
+    // relink at the head
+    entry->prev = -1;
+    entry->next = lruHead;
+    cache[lruHead].prev = slot;
+    lruHead = slot;
+}
+
+//----------------------------------------------------------------------
+// SynchDisk::DiskRead/DiskWrite
+// 	Send a single request for a run of adjacent sectors to the raw 
+//	disk, and wait for it to complete.  Caller must hold the lock.
+//
+//	"firstSector" -- the first disk sector to read/write
+//	"count" -- the number of sectors
+//	"data" -- the buffer to read into/write from
+//----------------------------------------------------------------------
+
+void
+SynchDisk::DiskRead(int firstSector, int count, char* data)
+{
+    DiskRequest request(firstSector, count, data, FALSE);
+
+    Request(&request);
+}
+
+void
+SynchDisk::DiskWrite(int firstSector, int count, char* data)
+{
+    DiskRequest request(firstSector, count, data, TRUE);
+
+    Request(&request);
+}
+
+//----------------------------------------------------------------------
+// SynchDisk::Request
+// 	Start a request right away if the disk is idle, or else put it
+//	on the queue.  Then wait for the interrupt handler to say it is 
+//	done.  The lock is released while waiting, and re-acquired before
+//	returning.
+//
+//	"request" -- the transfer to do
+//----------------------------------------------------------------------
+
+void
+SynchDisk::Request(DiskRequest *request)
+{
+    IntStatus oldLevel;
+
+    ASSERT(lock->IsHeldByCurrentThread());
+
+    oldLevel = kernel->interrupt->SetLevel(IntOff);	// the queue is also
+						// used by the interrupt handler
+    if (active == NULL)
+	StartRequest(request);
+    else
+	pending->Append(request);
+    (void) kernel->interrupt->SetLevel(oldLevel);
+
+    lock->Release();
+    request->done->P();			// wait for interrupt
+    lock->Acquire();
+}
+
+//----------------------------------------------------------------------
+// SynchDisk::StartRequest
+// 	Hand a request to the raw disk.  Interrupts must be disabled.
+//
+//	"request" -- the transfer to start
+//----------------------------------------------------------------------
+
+void
+SynchDisk::StartRequest(DiskRequest *request)
+{
+    ASSERT(active == NULL);
+
+    active = request;
+    if (request->writing)
+	disk->WriteSectors(request->firstSector, request->count, request->data);
+    else
+	disk->ReadSectors(request->firstSector, request->count, request->data);
+}
+
+//----------------------------------------------------------------------
+// SynchDisk::NextRequest
+// 	Take the request that should be served next off the queue,
+//	according to the scheduling policy.  The queue must not be 
+//	empty, and interrupts must be disabled.
+//
+//	Under SSTF, the distance is the number of sectors between the
+//	request and the disk head.  Under C-LOOK, requests behind the
+//	head count as lying beyond the end of the disk, so the head
+//	sweeps upward and then jumps back to the lowest request.  Ties
+//	go to the request that arrived first.
+//----------------------------------------------------------------------
+
+DiskRequest *
+SynchDisk::NextRequest()
+{
+    ListIterator<DiskRequest *> iter(pending);
+    DiskRequest *best = NULL;
+    int head = disk->HeadPosition();
+    int distance, bestDistance = 0;
+
+    ASSERT(!pending->IsEmpty());
+    if (policy == DiskFIFO)
+	return pending->RemoveFront();
+
+    for (; !iter.IsDone(); iter.Next()) {
+	DiskRequest *request = iter.Item();
+
+	if (policy == DiskSSTF)
+	    distance = abs(request->firstSector - head);
+	else if (request->firstSector >= head)		// C-LOOK
+	    distance = request->firstSector - head;
+	else
+	    distance = request->firstSector + NumSectors;
+	if ((best == NULL) || (distance < bestDistance)) {
+	    best = request;
+	    bestDistance = distance;
+	}
+    }
+    pending->Remove(best);
+    return best;
+}
+
 //----------------------------------------------------------------------
 // SynchDisk::CallBack
-// 	Disk interrupt handler.  Wake up any thread waiting for the disk
-//	request to finish.
+// 	Disk interrupt handler.  Start the next queued request, if any,
+//	and wake up the thread waiting for the one that just finished.
 //----------------------------------------------------------------------
 
 void
 SynchDisk::CallBack()
 { 
-    semaphore->V();
+    DiskRequest *finished = active;
+
+    ASSERT(finished != NULL);
+    active = NULL;
+    if (!pending->IsEmpty())
+	StartRequest(NextRequest());
+    finished->done->V();
 }
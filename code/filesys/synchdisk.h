@@ -25,10 +25,72 @@
 // This class provides the abstraction that for any individual thread
 // making a request, it waits around until the operation finishes before
 // returning.
+//
+// In front of the raw disk sits a small buffer cache of recently used
+// sectors.  A read that hits in the cache is satisfied from memory;
+// a write only updates the cached copy and marks it dirty.  Dirty
+// sectors go to disk when they are evicted (least recently used first),
+// or when Flush is called.
+//
+// Behind the cache, requests from different threads wait in a queue
+// for the disk.  Whenever the disk finishes a request, the next one is
+// chosen according to a scheduling policy, to cut down on head movement.
+//
+// ReadAhead lets a caller that expects to need some sectors soon start
+// reading them into the cache without waiting.  A worker thread does
+// the reads, so they queue up behind other disk requests like any 
+// other read.
+//
+// Dirty sectors are written behind by a flusher thread, so that 
+// repeated small writes to a sector reach the disk once.  The flusher
+// runs every FlushTicks of simulated time while there is anything to
+// write (the Alarm calls Tick), or as soon as DirtyThreshold sectors
+// are dirty.
+
+#define NumCacheSectors	64		// number of sectors in the cache;
+					// enough for two full tracks of
+					// read-ahead
+#define DirtyThreshold	(NumCacheSectors / 4)
+					// dirty sectors that wake the flusher
+#define FlushTicks	5000		// longest a sector stays dirty
+					// (roughly) before it is written
+
+// The following class defines one slot of the buffer cache.  Slots
+// are chained on a doubly-linked LRU list by slot number, so that
+// moving a slot to the front of the list takes constant time.
+
+class CacheEntry {
+  public:
+    int sector;				// sector cached in this slot, 
+					// or -1 if the slot is unused
+    bool dirty;				// modified since read from disk?
+    bool busy;				// disk I/O in progress on this slot?
+					// (if so, its data must not be used)
+    int prev;				// next more recently used slot
+    int next;				// next less recently used slot
+    char data[SectorSize];		// contents of the sector
+};
+
+// The following class defines a request waiting for, or being served
+// by, the disk.  The requesting thread sleeps on "done" until the disk
+// interrupt says the transfer is complete.
+
+class DiskRequest {
+  public:
+    DiskRequest(int first, int n, char *buffer, bool write);
+    ~DiskRequest();
+
+    int firstSector;			// first sector to transfer
+    int count;				// number of adjacent sectors
+    char *data;				// where the data goes/comes from
+    bool writing;			// write (or read) request?
+    Semaphore *done;			// signalled when the disk finishes
+};
 
 class SynchDisk : public CallBackObj {
   public:
-    SynchDisk();    		        // Initialize a synchronous disk,
+    SynchDisk(DiskPolicy policy = DiskCLOOK);
+    					// Initialize a synchronous disk,
 					// by initializing the raw Disk.
     ~SynchDisk();			// De-allocate the synch disk data
     
@@ -39,6 +101,23 @@ class SynchDisk : public CallBackObj {
     					// Disk::ReadRequest/WriteRequest and
 					// then wait until the request is done.
     void WriteSector(int sectorNumber, char* data);
+
+    void ReadSectors(int firstSector, int count, char* data);
+    					// Read/write "count" adjacent sectors,
+					// sending each run of sectors that 
+					// needs the disk as one request
+    void WriteSectors(int firstSector, int count, char* data);
+
+    void ReadAhead(int firstSector, int count);
+    					// Start reading "count" adjacent 
+					// sectors into the cache, without
+					// waiting for them
+
+    void Flush();			// Write every dirty cached sector
+					// back to disk
+    void Tick();			// Called by the Alarm on every timer
+					// interrupt; wakes the flusher when
+					// dirty sectors have waited long enough
     
     void CallBack();			// Called by the disk device interrupt
 					// handler, to signal that the
@@ -46,10 +125,66 @@ class SynchDisk : public CallBackObj {
 
   private:
     Disk *disk;		  		// Raw disk device
-    Semaphore *semaphore; 		// To synchronize requesting thread 
-					// with the interrupt handler
-    Lock *lock;		  		// Only one read/write request
-					// can be sent to the disk at a time
+    Lock *lock;		  		// Protects the cache; not held 
+					// while waiting for the disk
+    Condition *slotReady;		// Signalled when I/O on a busy 
+					// cache slot finishes
+    CacheEntry *cache;			// The buffer cache slots
+    int *cacheSlot;			// For each sector, the slot caching 
+					// it, or -1 if it is not cached
+    int lruHead;			// Most recently used slot
+    int lruTail;			// Least recently used slot
+
+    DiskPolicy policy;			// How to pick the next request
+    List<DiskRequest *> *pending;	// Requests waiting for the disk
+    DiskRequest *active;		// Request the disk is serving, 
+					// or NULL if the disk is idle
+
+    List<DiskRequest *> *readAhead;	// Sectors wanted by ReadAhead, not
+					// yet handed to the disk
+    Condition *readAheadWanted;		// Signalled when readAhead grows
+    Thread *readAheadThread;		// Serves readAhead; created when 
+					// first needed
+
+    void Fetch(int firstSector, int count, char* data, bool hint);
+					// Bring sectors into the cache and 
+					// copy them out (or just bring them
+					// in, if "hint")
+    static void ReadAheadWorker(void *data);
+					// Body of the read-ahead thread
+
+    int numDirty;			// Number of dirty cache slots
+    Semaphore *flushWanted;		// V'ed to wake the flusher
+    bool flushPosted;			// flushWanted V'ed, not yet P'ed?
+    int lastFlush;			// When the flusher last ran
+    Thread *flushThread;		// Writes dirty sectors behind; 
+					// created with the first one
+
+    void MarkDirty(int slot);		// A cached sector was modified
+    void MarkClean(int slot);		// ... or written back
+    void WakeFlusher();			// Get the flusher going, if it is
+					// not already
+    static void FlushWorker(void *data);
+					// Body of the flusher thread
+
+    int GetSlot(int sectorNumber, bool fetch);
+					// Find or make a slot for a sector
+    int FindVictim();			// Least recently used slot that is
+					// not busy, or -1
+    void TakeSlot(int slot, int sectorNumber);
+					// Reassign a clean slot to a sector
+    void WriteBackSlot(int slot);	// Write a dirty slot to disk
+    void MoveToFront(int slot);		// Mark a slot most recently used
+
+    void DiskRead(int firstSector, int count, char* data);
+    void DiskWrite(int firstSector, int count, char* data);
+					// Queue one raw disk request, and
+					// wait for it to complete
+    void Request(DiskRequest *request);	// Queue a request and wait for it
+    void StartRequest(DiskRequest *request);
+					// Hand a request to the disk
+    DiskRequest *NextRequest();		// Remove the request to serve next
+					// from the queue
 };
 
 #endif // SYNCHDISK_H
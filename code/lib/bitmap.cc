@@ -10,6 +10,10 @@
 #include "debug.h"
 #include "bitmap.h"
 
+// Bit tricks used to search a word at a time (gcc builtins)
+#define LowestBit(word)		__builtin_ctz(word)	// # of lowest set bit
+#define BitsSet(word)		__builtin_popcount(word) // # of set bits
+
 //----------------------------------------------------------------------
 // BitMap::BitMap
 // 	Initialize a bitmap with "numItems" bits, so that every bit is clear.
@@ -28,11 +32,9 @@ Bitmap::Bitmap(int numItems)
     numWords = divRoundUp(numBits, BitsInWord);
     map = new unsigned int[numWords];
     for (i = 0; i < numWords; i++) {
-	map[i] = 0;		// initialize map to keep Purify happy
-    }
-    for (i = 0; i < numBits; i++) {
-        Clear(i);
+	map[i] = 0;		// every bit starts out clear
     }
+    numClear = numBits;
 }
 
 //----------------------------------------------------------------------
@@ -57,6 +59,8 @@ Bitmap::Mark(int which)
 { 
     ASSERT(which >= 0 && which < numBits);
 
+    if (!Test(which))
+	numClear--;
     map[which / BitsInWord] |= 1 << (which % BitsInWord);
 
     ASSERT(Test(which));
@@ -74,6 +78,8 @@ Bitmap::Clear(int which)
 {
     ASSERT(which >= 0 && which < numBits);
 
+    if (Test(which))
+	numClear++;
     map[which / BitsInWord] &= ~(1 << (which % BitsInWord));
 
     ASSERT(!Test(which));
@@ -104,38 +110,129 @@ Bitmap::Test(int which) const
 //	As a side effect, set the bit (mark it as in use).
 //	(In other words, find and allocate a bit.)
 //
+//	Words with every bit set are skipped; within the first word that
+//	has a clear bit, the lowest clear bit is found in one step.
+//
 //	If no bits are clear, return -1.
 //----------------------------------------------------------------------
 
 int 
 Bitmap::FindAndSet() 
 {
-    for (int i = 0; i < numBits; i++) {
-	if (!Test(i)) {
-	    Mark(i);
-	    return i;
+    if (numClear == 0)
+	return -1;
+    for (int w = 0; w < numWords; w++) {
+	if (map[w] != ~0u) {
+	    int which = w * BitsInWord + LowestBit(~map[w]);
+
+	    if (which >= numBits)	// only the padding is clear
+		return -1;
+	    Mark(which);
+	    return which;
 	}
     }
     return -1;
 }
 
 //----------------------------------------------------------------------
-// Bitmap::NumClear
-// 	Return the number of clear bits in the bitmap.
-//	(In other words, how many bits are unallocated?)
+// Bitmap::FindAndSetRun
+// 	Find the first run of "n" adjacent clear bits, and set them all.
+//	Return the number of the first bit in the run, or -1 if there is
+//	no run that long.
+//
+//	"n" is the number of bits wanted
 //----------------------------------------------------------------------
 
-int 
-Bitmap::NumClear() const
+int
+Bitmap::FindAndSetRun(int n)
 {
-    int count = 0;
+    int start, length;
 
-    for (int i = 0; i < numBits; i++) {
-	if (!Test(i)) {
-	    count++;
+    ASSERT(n > 0);
+    if (numClear < n)
+	return -1;
+    start = FindClearRun(0, numBits, n, &length);
+    if (length < n)
+	return -1;
+    for (int i = start; i < start + n; i++)
+	Mark(i);
+    return start;
+}
+
+//----------------------------------------------------------------------
+// Bitmap::FindClearRun
+// 	Look for a run of "wanted" clear bits within [from, to).  Return
+//	the start of the first such run; if there is none, return the 
+//	start of the longest run of clear bits.  The length of the run
+//	found (at most "wanted", 0 if every bit is set) goes in "*length".
+//
+//	Whole words that are entirely set or entirely clear are stepped
+//	over in one go.
+//----------------------------------------------------------------------
+
+int
+Bitmap::FindClearRun(int from, int to, int wanted, int *length) const
+{
+    int bestStart = -1, bestLen = 0;
+    int runStart = -1, runLen = 0;
+    int i = from;
+
+    ASSERT(from >= 0 && to <= numBits);
+    while (i < to) {
+	unsigned int word = map[i / BitsInWord];
+
+	if ((i % BitsInWord) == 0 && (i + BitsInWord) <= to 
+		&& (word == ~0u || word == 0)) {
+	    if (word == ~0u) {			// all set -- skip it
+		runLen = 0;
+		i += BitsInWord;
+		continue;
+	    }
+	    if (runLen == 0)			// all clear -- take it
+		runStart = i;
+	    runLen += BitsInWord;
+	    i += BitsInWord;
+	} else {
+	    if (Test(i))
+		runLen = 0;
+	    else if (runLen++ == 0)
+		runStart = i;
+	    i++;
+	}
+	if (runLen > bestLen) {
+	    bestStart = runStart;
+	    bestLen = runLen;
+	    if (bestLen >= wanted) {
+		bestLen = wanted;
+		break;
+	    }
 	}
     }
-    return count;
+    *length = bestLen;
+    return bestStart;
+}
+
+//----------------------------------------------------------------------
+// Bitmap::RecountClear
+// 	Recompute the number of clear bits from scratch, a word at a
+//	time.  Needed when the contents of "map" are replaced wholesale
+//	(for instance, read in from disk).
+//----------------------------------------------------------------------
+
+void
+Bitmap::RecountClear()
+{
+    int numSet = 0;
+    int lastBits = numBits % BitsInWord;	// bits used in last word
+
+    for (int w = 0; w < numWords; w++) {
+	unsigned int word = map[w];
+
+	if (w == numWords - 1 && lastBits != 0)
+	    word &= (1u << lastBits) - 1;	// ignore the padding
+	numSet += BitsSet(word);
+    }
+    numClear = numBits - numSet;
 }
 
 //----------------------------------------------------------------------
@@ -185,7 +282,21 @@ Bitmap::SelfTest()
         Mark(i);
     }
     ASSERT(FindAndSet() == -1);		// bitmap should be full!
+    ASSERT(NumClear() == 0);
+    for (i = 0; i < numBits; i++) {
+        Clear(i);
+    }
+    ASSERT(NumClear() == numBits);
+
+    // runs, including ones that cross a word boundary
+    Mark(BitsInWord - 2);
+    ASSERT(FindAndSetRun(BitsInWord - 2) == 0);
+    ASSERT(FindAndSetRun(4) == BitsInWord - 1);
+    ASSERT(NumClear() == numBits - (BitsInWord + 3));
+    ASSERT(FindAndSetRun(numBits) == -1);
     for (i = 0; i < numBits; i++) {
         Clear(i);
     }
+    RecountClear();
+    ASSERT(NumClear() == numBits);
 }
@@ -3,7 +3,9 @@
 //	can be either on or off.
 //
 //	Represented as an array of unsigned integers, on which we do
-//	modulo arithmetic to find the bit we are interested in.
+//	modulo arithmetic to find the bit we are interested in.  Searches
+//	work a word at a time, skipping over words that are entirely set,
+//	and the number of clear bits is kept up to date as bits change.
 //
 //	The bitmap can be parameterized with with the number of bits being 
 //	managed.
@@ -42,7 +44,11 @@ class Bitmap {
     int FindAndSet();         // Return the # of a clear bit, and as a side
 				// effect, set the bit. 
 				// If no bits are clear, return -1.
-    int NumClear() const;	// Return the number of clear bits
+    int FindAndSetRun(int n);	// Find "n" adjacent clear bits, set them,
+				// and return the # of the first one.
+				// If there is no such run, return -1.
+    int NumClear() const { return numClear; }
+				// Return the number of clear bits
 
     void Print() const;		// Print contents of bitmap
     void SelfTest();		// Test whether bitmap is working
@@ -54,6 +60,12 @@ class Bitmap {
 				//  multiple of the number of bits in
 				//  a word)
     unsigned int *map;		// bit storage
+    int numClear;		// number of bits that are clear
+
+    int FindClearRun(int from, int to, int wanted, int *length) const;
+				// Find a run of clear bits in [from, to)
+    void RecountClear();	// Recompute numClear, after "map" has
+				// been overwritten directly
 };
 
 #endif // BITMAP_H
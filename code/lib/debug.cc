@@ -20,26 +20,19 @@
 //
 // 	"flagList" is a string of characters for whose DEBUG messages are 
 //		to be enabled.
+//
+//	The list is turned into a bit mask once, here, so that IsEnabled
+//	is a table lookup rather than a search of the string.
 //----------------------------------------------------------------------
 
 Debug::Debug(char *flagList)
 {
-    enableFlags = flagList;
-}
+    bool all = (flagList != NULL && strchr(flagList, dbgAll) != NULL);
 
-
-//----------------------------------------------------------------------
-// Debug::IsEnabled
-//      Return TRUE if DEBUG messages with "flag" are to be printed.
-//----------------------------------------------------------------------
-
-bool
-Debug::IsEnabled(char flag)
-{
-    if (enableFlags != NULL) {
-	return ((strchr(enableFlags, flag) != 0) 
-		|| (strchr(enableFlags, '+') != 0));
-    } else {
-    	return FALSE;
-    }
+    for (int i = 0; i < 256 / 32; i++)
+	enableMask[i] = all ? ~0u : 0;
+    if (flagList != NULL) 
+	for (; *flagList != '\0'; flagList++)
+	    enableMask[(unsigned char) *flagList / 32] 
+			|= 1u << ((unsigned char) *flagList % 32);
 }
@@ -34,21 +34,46 @@ class Debug {
   public:
     Debug(char *flagList);
 
-    bool IsEnabled(char flag);
+    bool IsEnabled(char flag)	// Are messages with "flag" printed?
+	{ return (enableMask[(unsigned char) flag / 32] 
+			>> ((unsigned char) flag % 32)) & 1; }
 
   private:
-    char *enableFlags;		// controls which DEBUG messages are printed
+    unsigned int enableMask[256 / 32];	// one bit for each flag character,
+					// set if its messages are printed
 };
 
 extern Debug *debug;
 
+//----------------------------------------------------------------------
+// DEBUG_COMPILED_OUT
+//      Is the flag one whose messages are left out of this build?
+//
+//	The simulator checks the "dbgAddr" and "dbgMach" flags several
+//	times for every user instruction.  Building with -DNO_SIM_DEBUG
+//	removes those messages (and the checks) from the code, since
+//	the flag is a constant and the compiler drops the dead branch.
+//----------------------------------------------------------------------
+#ifdef NO_SIM_DEBUG
+#define DEBUG_COMPILED_OUT(flag)	((flag) == dbgAddr || (flag) == dbgMach)
+#else
+#define DEBUG_COMPILED_OUT(flag)	FALSE
+#endif
+
+//----------------------------------------------------------------------
+// DEBUG_ENABLED
+//      Are messages with the flag printed?  Use this, rather than
+//	debug->IsEnabled, to guard debugging code other than a DEBUG.
+//----------------------------------------------------------------------
+#define DEBUG_ENABLED(flag)						\
+    (!DEBUG_COMPILED_OUT(flag) && debug->IsEnabled(flag))
 
 //----------------------------------------------------------------------
 // DEBUG
 //      If flag is enabled, print a message.
 //----------------------------------------------------------------------
 #define DEBUG(flag,expr)                                                     \
-    if (!debug->IsEnabled(flag)) {} else { 				\
+    if (!DEBUG_ENABLED(flag)) {} else { 				\
         cerr << expr << "\n";   				        \
     }
 
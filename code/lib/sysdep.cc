@@ -33,6 +33,7 @@
 #include <sys/socket.h>
 #include <sys/un.h>
 #include <cerrno>
+#include <sys/mman.h>		// for MapFile
 
 #ifdef SOLARIS
 // KMS
@@ -149,6 +150,22 @@ UDelay(unsigned int useconds)
 
 }
 
+//----------------------------------------------------------------------
+// HostTime
+// 	Return the real time on the host, in seconds since some fixed
+//	point in the past.  Used to compare how long the simulation takes
+//	to run with how much simulated time passes.
+//----------------------------------------------------------------------
+
+double
+HostTime()
+{
+    struct timeval tv;
+
+    (void) gettimeofday(&tv, NULL);
+    return tv.tv_sec + tv.tv_usec / 1000000.0;
+}
+
 //----------------------------------------------------------------------
 // Abort
 // 	Quit and drop core.
@@ -420,6 +437,48 @@ Unlink(char *name)
     return unlink(name);
 }
 
+//----------------------------------------------------------------------
+// MapFile
+// 	Map the first "nBytes" of an open file into memory, so that 
+//	stores to the memory change the file.  Return the address of
+//	the mapping, or NULL if the file can't be mapped.
+//----------------------------------------------------------------------
+
+char *
+MapFile(int fd, int nBytes)
+{
+    void *addr = mmap(NULL, nBytes, PROT_READ|PROT_WRITE, MAP_SHARED, fd, 0);
+
+    if (addr == MAP_FAILED)
+	return NULL;
+    return (char *) addr;
+}
+
+//----------------------------------------------------------------------
+// SyncMappedFile
+// 	Write the pages of a mapped file back to the file, and wait for
+//	them to get there.  Abort on error.
+//----------------------------------------------------------------------
+
+void
+SyncMappedFile(char *addr, int nBytes)
+{
+    int retVal = msync(addr, nBytes, MS_SYNC);
+    ASSERT(retVal == 0);
+}
+
+//----------------------------------------------------------------------
+// UnmapFile
+// 	Remove a mapping made by MapFile.  Abort on error.
+//----------------------------------------------------------------------
+
+void
+UnmapFile(char *addr, int nBytes)
+{
+    int retVal = munmap(addr, nBytes);
+    ASSERT(retVal == 0);
+}
+
 //----------------------------------------------------------------------
 // OpenSocket
 // 	Open an interprocess communication (IPC) connection.  For now, 
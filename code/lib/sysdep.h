@@ -24,6 +24,8 @@ extern void Abort();
 extern void Exit(int exitCode);
 extern void Delay(int seconds);
 extern void UDelay(unsigned int usec);// rcgood - to avoid spinners.
+extern double HostTime();	// seconds of real time, since some fixed
+				// point in the past
 
 // Initialize system so that cleanUp routine is called when user hits ctl-C
 extern void CallOnUserAbort(void (*cleanup)(int));
@@ -53,6 +55,13 @@ extern int Tell(int fd);
 extern int Close(int fd);
 extern bool Unlink(char *name);
 
+// Map an open file into memory, shared with the file; write the mapped
+// pages back; unmap.  For simulating the disk without a host system
+// call per request.
+extern char *MapFile(int fd, int nBytes);
+extern void SyncMappedFile(char *addr, int nBytes);
+extern void UnmapFile(char *addr, int nBytes);
+
 // Other C library routines that are used by Nachos.
 // These are assumed to be portable, so we don't include a wrapper.
 extern "C" {
@@ -25,14 +25,26 @@
 
 const int MagicNumber = 0x456789ab;
 const int MagicSize = sizeof(int);
-const int DiskSize = (MagicSize + (NumSectors * SectorSize));
 
+// The geometry of the disk; set by Disk::ReadSuperBlock or Disk::Create.
+
+int SectorsPerTrack = DefaultSectorsPerTrack;
+int NumTracks = DefaultNumTracks;
+int NumSectors = DefaultSectorsPerTrack * DefaultNumTracks;
 
 //----------------------------------------------------------------------
 // Disk::Disk()
 // 	Initialize a simulated disk.  Open the UNIX file (creating it
 //	if it doesn't exist), and check the magic number to make sure it's 
-// 	ok to treat it as Nachos disk storage.
+// 	ok to treat it as Nachos disk storage.  The geometry comes from
+//	the disk's superblock.  A new disk is created if there is none,
+//	or if "-geom" asked for one.
+//
+//	A disk with no superblock was made by an older Nachos, with the
+//	default geometry.  It is only replaced if the file system is to
+//	be formatted anyway ("-f"); otherwise Nachos refuses to start, 
+//	rather than destroy what is on it.  The stub file system does 
+//	not look at the disk, so there it is left as it is.
 //
 //	"toCall" -- object to call when disk read/write request completes
 //----------------------------------------------------------------------
@@ -40,7 +52,6 @@ const int DiskSize = (MagicSize + (NumSectors * SectorSize));
 Disk::Disk(CallBackObj *toCall)
 {
     int magicNum;
-    int tmp = 0;
 
     DEBUG(dbgDisk, "Initializing the disk.");
     callWhenDone = toCall;
@@ -49,17 +60,39 @@ Disk::Disk(CallBackObj *toCall)
     
     sprintf(diskname,"DISK_%d",kernel->hostName);
     fileno = OpenForReadWrite(diskname, FALSE);
-    if (fileno >= 0) {		 	// file exists, check magic number 
-	Read(fileno, (char *) &magicNum, MagicSize);
-	ASSERT(magicNum == MagicNumber);
-    } else {				// file doesn't exist, create it
-        fileno = OpenForWrite(diskname);
-	magicNum = MagicNumber;  
-	WriteFile(fileno, (char *) &magicNum, MagicSize); // write magic number
-
-	// need to write at end of file, so that reads will not return EOF
-        Lseek(fileno, DiskSize - sizeof(int), 0);	
-	WriteFile(fileno, (char *)&tmp, sizeof(int));  
+    if ((fileno >= 0) && (kernel->diskTracks == 0)) {	
+	Read(fileno, (char *) &magicNum, MagicSize);	// file exists, check 
+	ASSERT(magicNum == MagicNumber);		// magic number 
+	if (!ReadSuperBlock()) {			// made by an older Nachos
+#ifndef FILESYS_STUB
+	    if (!kernel->formatFlag) {
+		cerr << diskname << " has no superblock; use -f to format "
+		     << "it, or -geom to make a new disk\n";
+		Exit(1);
+	    }
+	    Close(fileno);			// to be formatted anyway
+	    fileno = -1;
+#else
+	    diskSize = MagicSize + NumSectors * SectorSize;
+#endif
+	}
+    } else if (fileno >= 0) {		// to be replaced by a new geometry
+	Close(fileno);
+	fileno = -1;
+    }
+    if (fileno < 0) {			// make a new disk
+	if (kernel->diskTracks == 0)
+	    Create(DefaultNumTracks, DefaultSectorsPerTrack);
+	else
+	    Create(kernel->diskTracks, kernel->diskSectorsPerTrack);
+    }
+
+    image = NULL;
+    if (kernel->mapDisk) {		// serve requests from memory
+	image = MapFile(fileno, diskSize);
+	if (image == NULL) {
+	    DEBUG(dbgDisk, "Can't map the disk file; using read/write.");
+	}
     }
     active = FALSE;
 }
@@ -67,14 +100,83 @@ Disk::Disk(CallBackObj *toCall)
 //----------------------------------------------------------------------
 // Disk::~Disk()
 // 	Clean up disk simulation, by closing the UNIX file representing the
-//	disk.
+//	disk.  If the file is mapped, write it back first; this happens on
+//	both Halt and Cleanup, which delete the kernel.
 //----------------------------------------------------------------------
 
 Disk::~Disk()
 {
+    if (image != NULL) {
+	SyncMappedFile(image, diskSize);
+	UnmapFile(image, diskSize);
+    }
     Close(fileno);
 }
 
+//----------------------------------------------------------------------
+// Disk::ReadSuperBlock()
+// 	Read the superblock of an existing disk, and take the geometry 
+//	from it.  Return FALSE if the disk has no superblock.
+//----------------------------------------------------------------------
+
+bool
+Disk::ReadSuperBlock()
+{
+    SuperBlock super;
+
+    Lseek(fileno, SuperBlockSector * SectorSize + MagicSize, 0);
+    Read(fileno, (char *) &super, sizeof(SuperBlock));
+    if (super.magic != SuperBlockMagic) {
+	DEBUG(dbgDisk, "No superblock on the disk.");
+	return FALSE;
+    }
+    ASSERT(super.sectorSize == SectorSize);	// built for another disk?
+
+    SectorsPerTrack = super.sectorsPerTrack;
+    NumTracks = super.numTracks;
+    NumSectors = SectorsPerTrack * NumTracks;
+    diskSize = MagicSize + NumSectors * SectorSize;
+    DEBUG(dbgDisk, "Disk has " << NumTracks << " tracks of " << SectorsPerTrack << " sectors.");
+    return TRUE;
+}
+
+//----------------------------------------------------------------------
+// Disk::Create()
+// 	Replace the UNIX file with a new, empty disk of the given 
+//	geometry, recorded in a superblock in sector 0.
+//
+//	"tracks" -- the number of tracks
+//	"sectorsPerTrack" -- the number of sectors on each track
+//----------------------------------------------------------------------
+
+void
+Disk::Create(int tracks, int sectorsPerTrack)
+{
+    int magicNum = MagicNumber;
+    int tmp = 0;
+    SuperBlock super;
+
+    ASSERT((tracks > 0) && (sectorsPerTrack > 0));
+    SectorsPerTrack = sectorsPerTrack;
+    NumTracks = tracks;
+    NumSectors = SectorsPerTrack * NumTracks;
+    diskSize = MagicSize + NumSectors * SectorSize;
+    DEBUG(dbgDisk, "Creating a disk of " << NumTracks << " tracks of " << SectorsPerTrack << " sectors.");
+
+    fileno = OpenForWrite(diskname);
+    WriteFile(fileno, (char *) &magicNum, MagicSize); // write magic number
+
+    super.magic = SuperBlockMagic;
+    super.sectorSize = SectorSize;
+    super.sectorsPerTrack = SectorsPerTrack;
+    super.numTracks = NumTracks;
+    WriteFile(fileno, (char *) &super, sizeof(SuperBlock));
+
+    // need to write at end of file, so that reads will not return EOF
+    Lseek(fileno, diskSize - sizeof(int), 0);	
+    WriteFile(fileno, (char *)&tmp, sizeof(int));  
+}
+
 //----------------------------------------------------------------------
 // Disk::PrintSector()
 // 	Dump the data in a disk read/write request, for debugging.
@@ -113,39 +215,81 @@ PrintSector (bool writing, int sector, char *data)
 void
 Disk::ReadRequest(int sectorNumber, char* data)
 {
-    int ticks = ComputeLatency(sectorNumber, FALSE);
+    ReadSectors(sectorNumber, 1, data);
+}
+
+void
+Disk::WriteRequest(int sectorNumber, char* data)
+{
+    WriteSectors(sectorNumber, 1, data);
+}
+
+//----------------------------------------------------------------------
+// Disk::ReadSectors/WriteSectors
+// 	Simulate a request to read/write a run of adjacent disk sectors,
+//	as one transfer: a single lseek and read/write on the UNIX file,
+//	and a single interrupt when the whole run is done.
+//
+//	"firstSector" -- the first disk sector to read/write
+//	"count" -- the number of sectors
+//	"data" -- the bytes to be written, the buffer to hold the incoming 
+//		bytes (count * SectorSize bytes)
+//----------------------------------------------------------------------
+
+void
+Disk::ReadSectors(int firstSector, int count, char* data)
+{
+    int ticks = ComputeLatency(firstSector, count, FALSE);
 
     ASSERT(!active);				// only one request at a time
-    ASSERT((sectorNumber >= 0) && (sectorNumber < NumSectors));
+    ASSERT((firstSector >= 0) && (count > 0) 
+		&& (firstSector + count <= NumSectors));
     
-    DEBUG(dbgDisk, "Reading from sector " << sectorNumber);
-    Lseek(fileno, SectorSize * sectorNumber + MagicSize, 0);
-    Read(fileno, data, SectorSize);
+    DEBUG(dbgDisk, "Reading " << count << " sectors from sector " << firstSector);
+    if (image != NULL)
+	bcopy(&image[SectorSize * firstSector + MagicSize], data, 
+					count * SectorSize);
+    else {
+	Lseek(fileno, SectorSize * firstSector + MagicSize, 0);
+	Read(fileno, data, count * SectorSize);
+    }
     if (debug->IsEnabled('d'))
-	PrintSector(FALSE, sectorNumber, data);
+	for (int i = 0; i < count; i++)
+	    PrintSector(FALSE, firstSector + i, &data[i * SectorSize]);
     
     active = TRUE;
-    UpdateLast(sectorNumber);
+    kernel->stats->numDiskSeekTracks += 
+		abs(firstSector / SectorsPerTrack - lastSector / SectorsPerTrack);
+    UpdateLast(firstSector + count - 1);
     kernel->stats->numDiskReads++;
     kernel->interrupt->Schedule(this, ticks, DiskInt);
 }
 
 void
-Disk::WriteRequest(int sectorNumber, char* data)
+Disk::WriteSectors(int firstSector, int count, char* data)
 {
-    int ticks = ComputeLatency(sectorNumber, TRUE);
+    int ticks = ComputeLatency(firstSector, count, TRUE);
 
     ASSERT(!active);
-    ASSERT((sectorNumber >= 0) && (sectorNumber < NumSectors));
+    ASSERT((firstSector >= 0) && (count > 0) 
+		&& (firstSector + count <= NumSectors));
     
-    DEBUG(dbgDisk, "Writing to sector " << sectorNumber);
-    Lseek(fileno, SectorSize * sectorNumber + MagicSize, 0);
-    WriteFile(fileno, data, SectorSize);
+    DEBUG(dbgDisk, "Writing " << count << " sectors to sector " << firstSector);
+    if (image != NULL)
+	bcopy(data, &image[SectorSize * firstSector + MagicSize], 
+					count * SectorSize);
+    else {
+	Lseek(fileno, SectorSize * firstSector + MagicSize, 0);
+	WriteFile(fileno, data, count * SectorSize);
+    }
     if (debug->IsEnabled('d'))
-	PrintSector(TRUE, sectorNumber, data);
+	for (int i = 0; i < count; i++)
+	    PrintSector(TRUE, firstSector + i, &data[i * SectorSize]);
     
     active = TRUE;
-    UpdateLast(sectorNumber);
+    kernel->stats->numDiskSeekTracks += 
+		abs(firstSector / SectorsPerTrack - lastSector / SectorsPerTrack);
+    UpdateLast(firstSector + count - 1);
     kernel->stats->numDiskWrites++;
     kernel->interrupt->Schedule(this, ticks, DiskInt);
 }
@@ -249,6 +393,28 @@ Disk::ComputeLatency(int newSector, bool writing)
     return(seek + rotation + RotationTime);
 }
 
+//----------------------------------------------------------------------
+// Disk::ComputeLatency(int, int, bool)
+// 	Return how long it will take to read/write "count" adjacent 
+//	sectors starting at "firstSector".  The head seeks to the first
+//	sector as for a single-sector request; after that the sectors 
+//	pass under the head one per RotationTime, plus a one-track seek 
+//	each time the run crosses onto the next track.
+//----------------------------------------------------------------------
+
+int
+Disk::ComputeLatency(int firstSector, int count, bool writing)
+{
+    int ticks = ComputeLatency(firstSector, writing);
+
+    for (int sector = firstSector + 1; sector < firstSector + count; sector++) {
+	if ((sector % SectorsPerTrack) == 0)
+	    ticks += SeekTime;		// on to the next track
+	ticks += RotationTime;
+    }
+    return ticks;
+}
+
 //----------------------------------------------------------------------
 // Disk::UpdateLast
 //   	Keep track of the most recently requested sector.  So we can know
@@ -46,12 +46,59 @@
 // disks these days now come with a track buffer.
 //
 // The track buffer simulation can be disabled by compiling with -DNOTRACKBUF
+//
+// With "-dm", the UNIX file is mapped into memory, and each request is
+// a memory copy instead of a seek plus a read or write.  This only
+// makes the simulator faster; the simulated time of a request is the
+// same either way.
+
+//
+// The number of tracks and of sectors per track are chosen when a disk
+// is created (by default, or with "-geom"), and recorded in a 
+// superblock in sector 0, where they are found the next time the disk
+// is used.  The sector size is fixed at compile time, since the file 
+// system's on-disk structures are laid out to fit in one sector; it 
+// can be changed with -DSECTOR_SIZE=n, and is recorded too so that a
+// disk is never used with the wrong one.
+
+#ifndef SECTOR_SIZE
+#define SECTOR_SIZE 128
+#endif
+
+const int SectorSize = SECTOR_SIZE;	// number of bytes per disk sector
+const int DefaultSectorsPerTrack = 32;	// geometry of a new disk, unless
+const int DefaultNumTracks = 32;	// "-geom" says otherwise
+
+extern int SectorsPerTrack;		// number of sectors per disk track 
+extern int NumTracks;			// number of tracks per disk
+extern int NumSectors;			// total # of sectors per disk
+					// (all set when the Disk starts up)
+
+// The superblock, at the front of sector 0.  The file system keeps its 
+// own data in the sectors that follow (cf. filesys.cc).
+
+const int SuperBlockSector = 0;
+const int SuperBlockMagic = 0x5ca1ab1e;
 
-const int SectorSize = 128;		// number of bytes per disk sector
-const int SectorsPerTrack  = 32;	// number of sectors per disk track 
-const int NumTracks = 32;		// number of tracks per disk
-const int NumSectors = (SectorsPerTrack * NumTracks);
-					// total # of sectors per disk
+class SuperBlock {
+  public:
+    int magic;				// SuperBlockMagic, if formatted
+    int sectorSize;			// must match SectorSize
+    int sectorsPerTrack;
+    int numTracks;
+};
+
+// Disk scheduling policies: which queued request goes to the disk next
+// (the queue itself is kept by SynchDisk)
+
+enum DiskPolicy { 
+    DiskFIFO,				// in order of arrival
+    DiskSSTF,				// shortest seek first: the request
+					// closest to the disk head
+    DiskCLOOK 				// circular elevator: the closest 
+					// request at or beyond the head,
+					// or else the lowest-numbered one
+};
 
 class Disk : public CallBackObj {
   public:
@@ -67,6 +114,12 @@ class Disk : public CallBackObj {
     					// Only one request allowed at a time!
     void WriteRequest(int sectorNumber, char* data);
 
+    void ReadSectors(int firstSector, int count, char* data);
+    					// Read/write "count" adjacent sectors
+					// as a single request: one seek, 
+					// then a sequential transfer.
+    void WriteSectors(int firstSector, int count, char* data);
+
     void CallBack();			// Invoked when disk request 
 					// finishes. In turn calls, callWhenDone.
 
@@ -74,9 +127,17 @@ class Disk : public CallBackObj {
     					// Return how long a request to 
 					// newSector will take: 
 					// (seek + rotational delay + transfer)
+    int ComputeLatency(int firstSector, int count, bool writing);
+					// Same, for a multi-sector request
+
+    int HeadPosition() { return lastSector; }
+					// Sector the head was last over; 
+					// used to schedule queued requests
 
   private:
     int fileno;				// UNIX file number for simulated disk 
+    char *image;			// The UNIX file mapped into memory,
+					// or NULL if requests use read/write
     char diskname[32];			// name of simulated disk's file
     CallBackObj *callWhenDone;		// Invoke when any disk request finishes
     bool active;     			// Is a disk operation in progress?
@@ -84,6 +145,12 @@ class Disk : public CallBackObj {
     int bufferInit;			// When the track buffer started 
 					// being loaded
 
+    int diskSize;			// Size of the UNIX file, in bytes
+
+    bool ReadSuperBlock();		// Take the geometry from an existing
+					// disk; FALSE if it has none
+    void Create(int tracks, int sectorsPerTrack);
+					// Make a new, empty disk
     int TimeToSeek(int newSector, int *rotate); // time to get to the new track
     int ModuloDiff(int to, int from);        // # sectors between to and from
     void UpdateLast(int newSector);
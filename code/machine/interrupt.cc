@@ -23,6 +23,7 @@
 #include "copyright.h"
 #include "interrupt.h"
 #include "main.h"
+#include "synchdisk.h"
 
 // String definitions for debugging messages
 
@@ -142,21 +143,24 @@ Interrupt::SetLevel(IntStatus now)
 //
 //	Two things can cause OneTick to be called:
 //		interrupts are re-enabled
-//		a user instruction is executed
+//		a user instruction (or basic block) is executed
+//
+//	"count" -- the number of ticks to advance by, e.g., the number 
+//		of user instructions executed
 //----------------------------------------------------------------------
 void
-Interrupt::OneTick()
+Interrupt::OneTick(int count)
 {
     MachineStatus oldStatus = status;
     Statistics *stats = kernel->stats;
 
 // advance simulated time
     if (status == SystemMode) {
-        stats->totalTicks += SystemTick;
-	stats->systemTicks += SystemTick;
+        stats->totalTicks += count * SystemTick;
+	stats->systemTicks += count * SystemTick;
     } else {
-	stats->totalTicks += UserTick;
-	stats->userTicks += UserTick;
+	stats->totalTicks += count * UserTick;
+	stats->userTicks += count * UserTick;
     }
     DEBUG(dbgInt, "== Tick " << stats->totalTicks << " ==");
 
@@ -229,11 +233,15 @@ Interrupt::Idle()
 //----------------------------------------------------------------------
 // Interrupt::Halt
 // 	Shut down Nachos cleanly, printing out performance statistics.
+//	Dirty sectors in the disk cache are written back first, while
+//	the interrupt system is still around to complete the requests.
 //----------------------------------------------------------------------
 void
 Interrupt::Halt()
 {
     cout << "Machine halting!\n\n";
+    if (kernel->synchDisk != NULL)
+	kernel->synchDisk->Flush();
     kernel->stats->Print();
     delete kernel;	// Never returns.
 }
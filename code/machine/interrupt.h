@@ -114,7 +114,7 @@ class Interrupt {
 				// at time "when".  This is called
     				// by the hardware device simulators.
     
-    void OneTick();       	// Advance simulated time
+    void OneTick(int count = 1);	// Advance simulated time
 
   private:
     IntStatus level;		// are interrupts enabled or disabled?
@@ -50,9 +50,11 @@ void CheckEndian()
 //
 //	"debug" -- if TRUE, drop into the debugger after each user instruction
 //		is executed.
+//	"blocks" -- if TRUE, run user programs a basic block at a time
+//		(see RunBlock)
 //----------------------------------------------------------------------
 
-Machine::Machine(bool debug)
+Machine::Machine(bool debug, bool blocks)
 {
     int i;
 
@@ -70,8 +72,12 @@ Machine::Machine(bool debug)
     tlb = NULL;
     pageTable = NULL;
 #endif
+    for (i = 0; i < NumPhysPages; i++)
+	decodedPages[i] = NULL;
+    FlushTranslations();
 
     singleStep = debug;
+    runBlocks = blocks;
     CheckEndian();
 }
 
@@ -85,6 +91,47 @@ Machine::~Machine()
     delete [] mainMemory;
     if (tlb != NULL)
         delete [] tlb;
+    for (int i = 0; i < NumPhysPages; i++)
+	delete [] decodedPages[i];
+}
+
+//----------------------------------------------------------------------
+// Machine::InvalidateInstructions
+// 	Throw away the decoded instructions of the physical pages that
+//	hold the bytes from "physAddr" to "physAddr + size - 1".  The
+//	simulator notices stores done by user instructions on its own;
+//	the kernel must call this whenever it writes into "mainMemory"
+//	directly, e.g., when loading a program.
+//
+//	"physAddr" -- the first byte written
+//	"size" -- the number of bytes written
+//----------------------------------------------------------------------
+
+void
+Machine::InvalidateInstructions(int physAddr, int size)
+{
+    if (size <= 0)
+	return;
+    for (int page = physAddr / PageSize; 
+		page <= (physAddr + size - 1) / PageSize; page++) {
+	delete [] decodedPages[page];
+	decodedPages[page] = NULL;
+    }
+}
+
+//----------------------------------------------------------------------
+// Machine::FlushTranslations
+// 	Empty the caches of recent translations kept by Translate.  Must
+//	be called whenever the page table or TLB is changed (including 
+//	the use and dirty bits), e.g., on a context switch.
+//----------------------------------------------------------------------
+
+void
+Machine::FlushTranslations()
+{
+    for (int access = 0; access < NumAccessTypes; access++)
+	for (int i = 0; i < TranslationSlots; i++)
+	    translations[access][i].virtualPage = (unsigned int) -1;
 }
 
 //----------------------------------------------------------------------
@@ -106,6 +153,7 @@ Machine::RaiseException(ExceptionType which, int badVAddr)
     DelayedLoad(0, 0);			// finish anything in progress
     kernel->interrupt->setStatus(SystemMode);
     ExceptionHandler(which);		// interrupts are enabled at this point
+    FlushTranslations();		// the handler may have changed them
     kernel->interrupt->setStatus(UserMode);
 }
 
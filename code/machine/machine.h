@@ -39,6 +39,9 @@ const int NumPhysPages = 128;
 
 const int MemorySize = (NumPhysPages * PageSize);
 const int TLBSize = 4;			// if there is a TLB, make it small
+const int MaxBlockLength = 64;		// most instructions run between 
+					// interrupt checks, when running a
+					// basic block at a time
 
 enum ExceptionType { NoException,           // Everything ok!
 		     SyscallException,      // A program executed a system call.
@@ -75,6 +78,54 @@ enum ExceptionType { NoException,           // Everything ok!
 
 #define NumTotalRegs 	40
 
+// The following class defines an instruction, represented in both
+// 	undecoded binary form
+//      decoded to identify
+//	    operation to do
+//	    registers to act on
+//	    any immediate operand value
+//
+// The simulator keeps the decoded form of the instructions on each
+// physical page it has run code from, so that an instruction that is
+// executed over and over is only decoded once.
+
+class Instruction {
+  public:
+    void Decode();	// decode the binary representation of the instruction
+
+    unsigned int value; // binary representation of the instruction
+
+    char opCode;     // Type of instruction.  This is NOT the same as the
+    		     // opcode field from the instruction: see defs in mips.h
+    char rs, rt, rd; // Three registers from instruction.
+    int extra;       // Immediate or target or shamt field or offset.
+                     // Immediates are sign-extended.
+    bool decoded;    // Do the fields above hold the decoded form of
+		     // the word now in memory?
+};
+
+#define InstrsPerPage	(PageSize / 4)	// instructions on a page of memory
+
+// The kinds of memory access the simulator translates addresses for.
+// Each kind has its own cache of recent translations.
+
+enum AccessType { ReadAccess,		// load, or kernel reading memory
+		  WriteAccess,		// store, or kernel writing memory
+		  FetchAccess,		// instruction fetch
+		  NumAccessTypes };
+
+// The following class defines a cached translation: virtual page
+// "virtualPage" is at byte "frameAddr" of main memory.
+
+class CachedTranslation {
+  public:
+    unsigned int virtualPage;	// (unsigned int) -1 if the slot is empty
+    int frameAddr;		// physical address of the start of the page
+};
+
+#define TranslationSlots 8	// cached translations per kind of access;
+				// must be a power of 2
+
 // The following class defines the simulated host workstation hardware, as 
 // seen by user programs -- the CPU registers, main memory, etc.
 // User programs shouldn't be able to tell that they are running on our 
@@ -88,12 +139,12 @@ enum ExceptionType { NoException,           // Everything ok!
 // The procedures in this class are defined in machine.cc, mipssim.cc, and
 // translate.cc.
 
-class Instruction;
 class Interrupt;
 
 class Machine {
   public:
-    Machine(bool debug);	// Initialize the simulation of the hardware
+    Machine(bool debug, bool blocks = FALSE);
+				// Initialize the simulation of the hardware
 				// for running user programs
     ~Machine();			// De-allocate the data structures
 
@@ -143,18 +194,46 @@ class Machine {
     				// Read or write 1, 2, or 4 bytes of virtual 
 				// memory (at addr).  Return FALSE if a 
 				// correct translation couldn't be found.
+
+    bool ReadMemBlock(int addr, int size, char *into);
+    bool WriteMemBlock(int addr, int size, char *from);
+				// Copy "size" bytes between virtual memory
+				// and a kernel buffer, translating each
+				// page only once.  Return FALSE (without
+				// raising an exception) if a page couldn't
+				// be translated.
+    int ReadMemString(int addr, int maxSize, char *into);
+    int WriteMemString(int addr, int maxSize, char *from);
+				// Same, for a '\0'-terminated string of at
+				// most "maxSize" bytes including the '\0'.
+				// Return the string length, or -1.
+
+    void InvalidateInstructions(int physAddr, int size);
+				// Forget the decoded instructions on the
+				// physical pages holding these bytes; the
+				// kernel must call this after writing to
+				// "mainMemory" directly
+    void FlushTranslations();	// Forget the translations remembered by
+				// the simulator; the kernel must call this
+				// after changing the page table or TLB
   private:
 
 // Routines internal to the machine simulation -- DO NOT call these directly
     void DelayedLoad(int nextReg, int nextVal);  	
 				// Do a pending delayed load (modifying a reg)
 
-    void OneInstruction(Instruction *instr); 	
-    				// Run one instruction of a user program.
+    bool OneInstruction(Instruction *instr);
+				// Run one instruction of a user program.
+    int RunBlock();		// Run one basic block of a user program;
+				// return the number of instructions
+    Instruction *FetchInstruction();
+				// Return the decoded instruction at the PC,
+				// or NULL after an exception
     
 
 
-    ExceptionType Translate(int virtAddr, int* physAddr, int size,bool writing);
+    ExceptionType Translate(int virtAddr, int* physAddr, int size,
+				AccessType access);
     				// Translate an address, and check for 
 				// alignment.  Set the use and dirty bits in 
 				// the translation entry appropriately,
@@ -177,6 +256,15 @@ class Machine {
 				// simulated instruction
     int runUntilTime;		// drop back into the debugger when simulated
 				// time reaches this value
+    bool runBlocks;		// run a basic block between interrupt 
+				// checks, rather than one instruction
+
+    Instruction *decodedPages[NumPhysPages];
+				// decoded instructions of each physical
+				// page, or NULL if none have been run
+    CachedTranslation translations[NumAccessTypes][TranslationSlots];
+				// recent successful translations, by kind
+				// of access, and then by virtual page
 
     friend class Interrupt;		// calls DelayedLoad()    
 };
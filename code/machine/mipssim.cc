@@ -24,26 +24,6 @@
 
 static void Mult(int a, int b, bool signedArith, int* hiPtr, int* loPtr);
 
-// The following class defines an instruction, represented in both
-// 	undecoded binary form
-//      decoded to identify
-//	    operation to do
-//	    registers to act on
-//	    any immediate operand value
-
-class Instruction {
-  public:
-    void Decode();	// decode the binary representation of the instruction
-
-    unsigned int value; // binary representation of the instruction
-
-    char opCode;     // Type of instruction.  This is NOT the same as the
-    		     // opcode field from the instruction: see defs in mips.h
-    char rs, rt, rd; // Three registers from instruction.
-    int extra;       // Immediate or target or shamt field or offset.
-                     // Immediates are sign-extended.
-};
-
 //----------------------------------------------------------------------
 // Machine::Run
 // 	Simulate the execution of a user-level program on Nachos.
@@ -56,21 +36,77 @@ class Instruction {
 void
 Machine::Run()
 {
-    Instruction *instr = new Instruction;  // storage for decoded instruction
-
-    if (debug->IsEnabled('m')) {
+    if (DEBUG_ENABLED(dbgMach)) {
         cout << "Starting program in thread: " << kernel->currentThread->getName();
 	cout << ", at time: " << kernel->stats->totalTicks << "\n";
     }
     kernel->interrupt->setStatus(UserMode);
     for (;;) {
-        OneInstruction(instr);
+	if (runBlocks && !singleStep) {
+	    kernel->interrupt->OneTick(RunBlock());
+	    continue;
+	}
+	Instruction *instr = FetchInstruction();
+
+	if (instr != NULL)		// else an exception occurred
+            OneInstruction(instr);
 	kernel->interrupt->OneTick();
 	if (singleStep && (runUntilTime <= kernel->stats->totalTicks))
 	  Debugger();
     }
 }
 
+//----------------------------------------------------------------------
+// IsBranch
+// 	Is the operation a branch or jump?  The instruction after it (in
+//	its delay slot) is the last one of a basic block.
+//----------------------------------------------------------------------
+
+static inline bool
+IsBranch(int opCode)
+{
+    return (opCode >= OP_BEQ && opCode <= OP_BNE) 
+		|| (opCode >= OP_J && opCode <= OP_JR);
+}
+
+//----------------------------------------------------------------------
+// Machine::RunBlock
+// 	Execute one basic block of a user-level program: instructions 
+//	are run back to back, up to and including the delay slot of the
+//	first branch or jump.  The block also ends early after an 
+//	exception, or after MaxBlockLength instructions.  A syscall
+//	always starts a block of its own, so that the instructions before
+//	it are charged for before the kernel runs.
+//
+//	Returns the number of instructions run (counting one that raised
+//	an exception), for the caller to charge for all at once.  Pending
+//	interrupts are then only checked between blocks, rather than after
+//	every instruction; that is what makes this faster than running
+//	one instruction at a time.  Since blocks always end at the same
+//	places, simulated time is as repeatable as before.
+//----------------------------------------------------------------------
+
+int
+Machine::RunBlock()
+{
+    Instruction *instr;
+    bool inDelaySlot = FALSE;
+    int count = 0;
+
+    for (;;) {
+	instr = FetchInstruction();
+	if (instr == NULL)			// exception occurred
+	    return count + 1;
+	if (instr->opCode == OP_SYSCALL && count > 0)
+	    return count;
+	count++;
+	if (!OneInstruction(instr) || inDelaySlot 
+			|| count == MaxBlockLength)
+	    return count;
+	inDelaySlot = IsBranch(instr->opCode);
+    }
+}
+
 
 //----------------------------------------------------------------------
 // TypeToReg
@@ -96,7 +132,8 @@ TypeToReg(RegType reg, Instruction *instr)
 
 //----------------------------------------------------------------------
 // Machine::OneInstruction
-// 	Execute one instruction from a user-level program
+// 	Execute one instruction from a user-level program.  Returns 
+//	FALSE if the instruction raised an exception.
 //
 // 	If there is any kind of exception or interrupt, we invoke the 
 //	exception handler, and when it returns, we return to Run(), which
@@ -114,28 +151,26 @@ TypeToReg(RegType reg, Instruction *instr)
 //	store all data back to the machine registers and memory before
 //	leaving.  This allows the Nachos kernel to control our behavior
 //	by controlling the contents of memory, the translation table,
-//	and the register set.
+//	and the register set.  (The exceptions -- decoded instructions, 
+//	and recently used translations -- are dropped whenever
+//	the kernel changes memory or the translation table; cf.
+//	InvalidateInstructions, FlushTranslations.)
+//
+//	"instr" -- the decoded instruction at the PC (cf. FetchInstruction)
 //----------------------------------------------------------------------
 
-void
+bool
 Machine::OneInstruction(Instruction *instr)
 {
 #ifdef SIM_FIX
     int byte;       // described in Kane for LWL,LWR,...
 #endif
 
-    int raw;
     int nextLoadReg = 0; 	
     int nextLoadValue = 0; 	// record delayed load operation, to apply
 				// in the future
 
-    // Fetch instruction 
-    if (!ReadMem(registers[PCReg], 4, &raw))
-	return;			// exception occurred
-    instr->value = raw;
-    instr->Decode();
-
-    if (debug->IsEnabled('m')) {
+    if (DEBUG_ENABLED(dbgMach)) {
         struct OpString *str = &opStrings[instr->opCode];
 	char buf[80];
 
@@ -159,7 +194,7 @@ Machine::OneInstruction(Instruction *instr)
 	if (!((registers[instr->rs] ^ registers[instr->rt]) & SIGN_BIT) &&
 	    ((registers[instr->rs] ^ sum) & SIGN_BIT)) {
 	    RaiseException(OverflowException, 0);
-	    return;
+	    return FALSE;
 	}
 	registers[instr->rd] = sum;
 	break;
@@ -169,7 +204,7 @@ Machine::OneInstruction(Instruction *instr)
 	if (!((registers[instr->rs] ^ instr->extra) & SIGN_BIT) &&
 	    ((instr->extra ^ sum) & SIGN_BIT)) {
 	    RaiseException(OverflowException, 0);
-	    return;
+	    return FALSE;
 	}
 	registers[instr->rt] = sum;
 	break;
@@ -225,9 +260,14 @@ Machine::OneInstruction(Instruction *instr)
 	break;
 	
       case OP_DIV:
+	// The result of dividing by zero, or of the one quotient that 
+	// overflows, is undefined; don't let the host trap on them.
 	if (registers[instr->rt] == 0) {
 	    registers[LoReg] = 0;
 	    registers[HiReg] = 0;
+	} else if (registers[instr->rt] == -1) {
+	    registers[LoReg] = - (unsigned int) registers[instr->rs];
+	    registers[HiReg] = 0;
 	} else {
 	    registers[LoReg] =  registers[instr->rs] / registers[instr->rt];
 	    registers[HiReg] = registers[instr->rs] % registers[instr->rt];
@@ -264,7 +304,7 @@ Machine::OneInstruction(Instruction *instr)
       case OP_LBU:
 	tmp = registers[instr->rs] + instr->extra;
 	if (!ReadMem(tmp, 1, &value))
-	    return;
+	    return FALSE;
 
 	if ((value & 0x80) && (instr->opCode == OP_LB))
 	    value |= 0xffffff00;
@@ -279,10 +319,10 @@ Machine::OneInstruction(Instruction *instr)
 	tmp = registers[instr->rs] + instr->extra;
 	if (tmp & 0x1) {
 	    RaiseException(AddressErrorException, tmp);
-	    return;
+	    return FALSE;
 	}
 	if (!ReadMem(tmp, 2, &value))
-	    return;
+	    return FALSE;
 
 	if ((value & 0x8000) && (instr->opCode == OP_LH))
 	    value |= 0xffff0000;
@@ -301,10 +341,10 @@ Machine::OneInstruction(Instruction *instr)
 	tmp = registers[instr->rs] + instr->extra;
 	if (tmp & 0x3) {
 	    RaiseException(AddressErrorException, tmp);
-	    return;
+	    return FALSE;
 	}
 	if (!ReadMem(tmp, 4, &value))
-	    return;
+	    return FALSE;
 	nextLoadReg = instr->rt;
 	nextLoadValue = value;
 	break;
@@ -324,7 +364,7 @@ Machine::OneInstruction(Instruction *instr)
         // DEBUG('P', "Addr 0x%X\n",tmp-byte);
 
         if (!ReadMem(tmp-byte, 4, &value))
-            return;
+            return FALSE;
 #else
 	// ReadMem assumes all 4 byte requests are aligned on an even 
 	// word boundary.  Also, the little endian/big endian swap code would
@@ -332,7 +372,7 @@ Machine::OneInstruction(Instruction *instr)
 	ASSERT((tmp & 0x3) == 0);  
 
 	if (!ReadMem(tmp, 4, &value))
-	    return;
+	    return FALSE;
 #endif
 
 	if (registers[LoadReg] == instr->rt)
@@ -376,7 +416,7 @@ Machine::OneInstruction(Instruction *instr)
         // DEBUG('P', "Addr 0x%X\n",tmp-byte);
 
         if (!ReadMem(tmp-byte, 4, &value))
-            return;
+            return FALSE;
 #else
 	// ReadMem assumes all 4 byte requests are aligned on an even 
 	// word boundary.  Also, the little endian/big endian swap code would
@@ -384,7 +424,7 @@ Machine::OneInstruction(Instruction *instr)
 	ASSERT((tmp & 0x3) == 0);  
 
 	if (!ReadMem(tmp, 4, &value))
-	    return;
+	    return FALSE;
 #endif
 
 	if (registers[LoadReg] == instr->rt)
@@ -458,13 +498,13 @@ Machine::OneInstruction(Instruction *instr)
       case OP_SB:
 	if (!WriteMem((unsigned) 
 		(registers[instr->rs] + instr->extra), 1, registers[instr->rt]))
-	    return;
+	    return FALSE;
 	break;
 	
       case OP_SH:
 	if (!WriteMem((unsigned) 
 		(registers[instr->rs] + instr->extra), 2, registers[instr->rt]))
-	    return;
+	    return FALSE;
 	break;
 	
       case OP_SLL:
@@ -534,7 +574,7 @@ Machine::OneInstruction(Instruction *instr)
 	if (((registers[instr->rs] ^ registers[instr->rt]) & SIGN_BIT) &&
 	    ((registers[instr->rs] ^ diff) & SIGN_BIT)) {
 	    RaiseException(OverflowException, 0);
-	    return;
+	    return FALSE;
 	}
 	registers[instr->rd] = diff;
 	break;
@@ -546,7 +586,7 @@ Machine::OneInstruction(Instruction *instr)
       case OP_SW:
 	if (!WriteMem((unsigned) 
 		(registers[instr->rs] + instr->extra), 4, registers[instr->rt]))
-	    return;
+	    return FALSE;
 	break;
 	
       case OP_SWL:	  
@@ -562,7 +602,7 @@ Machine::OneInstruction(Instruction *instr)
         byte = tmp & 0x3;
         // DEBUG('P', "Addr 0x%X\n",tmp-byte);
         if (!ReadMem(tmp-byte, 4, &value))
-            return;
+            return FALSE;
 
         // DEBUG('P', "Value 0x%X\n",value);
 #else
@@ -572,7 +612,7 @@ Machine::OneInstruction(Instruction *instr)
 	ASSERT((tmp & 0x3) == 0);  
 
 	if (!ReadMem((tmp & ~0x3), 4, &value))
-	    return;
+	    return FALSE;
 #endif
 
 #ifdef SIM_FIX
@@ -599,12 +639,12 @@ Machine::OneInstruction(Instruction *instr)
 	}
 #ifndef SIM_FIX
         if (!WriteMem((tmp & ~0x3), 4, value))
-            return;
+            return FALSE;
 #else
         // DEBUG('P', "Value 0x%X\n",value);
 
         if (!WriteMem((tmp - byte), 4, value))
-            return;
+            return FALSE;
 #endif // SIM_FIX
 	break;
     	
@@ -617,7 +657,7 @@ Machine::OneInstruction(Instruction *instr)
         ASSERT((tmp & 0x3) == 0);  
 
         if (!ReadMem((tmp & ~0x3), 4, &value))
-            return;
+            return FALSE;
 #else
         // The only difference between this code and the BIG ENDIAN code
         // is that the ReadMem call is guaranteed an aligned access as 
@@ -630,7 +670,7 @@ Machine::OneInstruction(Instruction *instr)
         // DEBUG('P', "Addr 0x%X\n",tmp-byte);
 
         if (!ReadMem(tmp-byte, 4, &value))
-            return;
+            return FALSE;
         // DEBUG('P', "Value 0x%X\n",value);
 #endif // SIM_FIX
 
@@ -656,12 +696,12 @@ Machine::OneInstruction(Instruction *instr)
 
 #ifndef SIM_FIX
         if (!WriteMem((tmp & ~0x3), 4, value))
-            return;
+            return FALSE;
 #else
         // DEBUG('P', "Value 0x%X\n",value);
 
         if (!WriteMem((tmp - byte), 4, value))
-            return;
+            return FALSE;
 #endif // SIM_FIX
 
 
@@ -669,7 +709,7 @@ Machine::OneInstruction(Instruction *instr)
     	
       case OP_SYSCALL:
 	RaiseException(SyscallException, 0);
-	return; 
+	return FALSE;
 	
       case OP_XOR:
 	registers[instr->rd] = registers[instr->rs] ^ registers[instr->rt];
@@ -682,7 +722,7 @@ Machine::OneInstruction(Instruction *instr)
       case OP_RES:
       case OP_UNIMP:
 	RaiseException(IllegalInstrException, 0);
-	return;
+	return FALSE;
 	
       default:
 	ASSERT(FALSE);
@@ -698,6 +738,45 @@ Machine::OneInstruction(Instruction *instr)
 						// are jumping into lala-land
     registers[PCReg] = registers[NextPCReg];
     registers[NextPCReg] = pcAfter;
+    return TRUE;
+}
+
+//----------------------------------------------------------------------
+// Machine::FetchInstruction
+// 	Return the decoded instruction at the PC.  If there is an 
+//	exception, raise it, and return NULL.
+//
+//	The instruction comes out of the decoded copy of its physical 
+//	page, and is only read from memory and decoded if it has not been
+//	run since it was last written.
+//----------------------------------------------------------------------
+
+Instruction *
+Machine::FetchInstruction()
+{
+    int pc = registers[PCReg];
+    int physAddr;
+    Instruction *page, *instr;
+    ExceptionType exception = Translate(pc, &physAddr, 4, FetchAccess);
+
+    if (exception != NoException) {
+	RaiseException(exception, pc);
+	return NULL;
+    }
+
+    page = decodedPages[physAddr / PageSize];
+    if (page == NULL) {
+	page = decodedPages[physAddr / PageSize] = new Instruction[InstrsPerPage];
+	for (int i = 0; i < InstrsPerPage; i++)
+	    page[i].decoded = FALSE;
+    }
+    instr = &page[(physAddr % PageSize) / 4];
+    if (!instr->decoded) {
+	instr->value = WordToHost(*(unsigned int *) &mainMemory[physAddr]);
+	instr->Decode();
+	instr->decoded = TRUE;
+    }
+    return instr;
 }
 
 //----------------------------------------------------------------------
@@ -765,64 +844,19 @@ Instruction::Decode()
 // Mult
 // 	Simulate R2000 multiplication.
 // 	The words at *hiPtr and *loPtr are overwritten with the
-// 	double-length result of the multiplication.
+// 	double-length result of the multiplication, computed with the
+//	host's own 64-bit arithmetic.
 //----------------------------------------------------------------------
 
 static void
 Mult(int a, int b, bool signedArith, int* hiPtr, int* loPtr)
 {
-    if ((a == 0) || (b == 0)) {
-	*hiPtr = *loPtr = 0;
-	return;
-    }
-
-    // Compute the sign of the result, then make everything positive
-    // so unsigned computation can be done in the main loop.
-    bool negative = FALSE;
-    if (signedArith) {
-	if (a < 0) {
-	    negative = !negative;
-	    a = -a;
-	}
-	if (b < 0) {
-	    negative = !negative;
-	    b = -b;
-	}
-    }
-
-    // Compute the result in unsigned arithmetic (check a's bits one at
-    // a time, and add in a shifted value of b).
-    unsigned int bLo = b;
-    unsigned int bHi = 0;
-    unsigned int lo = 0;
-    unsigned int hi = 0;
-    for (int i = 0; i < 32; i++) {
-	if (a & 1) {
-	    lo += bLo;
-	    if (lo < bLo)  // Carry out of the low bits?
-		hi += 1;
-	    hi += bHi;
-	    if ((a & 0xfffffffe) == 0)
-		break;
-	}
-	bHi <<= 1;
-	if (bLo & 0x80000000)
-	    bHi |= 1;
-	
-	bLo <<= 1;
-	a >>= 1;
-    }
-
-    // If the result is supposed to be negative, compute the two's
-    // complement of the double-word result.
-    if (negative) {
-	hi = ~hi;
-	lo = ~lo;
-	lo++;
-	if (lo == 0)
-	    hi++;
-    }
-    
-    *hiPtr = (int) hi;
-    *loPtr = (int) lo;
+    unsigned long long product;
+
+    if (signedArith)
+	product = (unsigned long long) ((long long) a * (long long) b);
+    else
+	product = (unsigned long long) (unsigned int) a * (unsigned int) b;
+    *hiPtr = (int) (unsigned int) (product >> 32);
+    *loPtr = (int) (unsigned int) product;
 }
@@ -19,9 +19,12 @@
 Statistics::Statistics()
 {
     totalTicks = idleTicks = systemTicks = userTicks = 0;
-    numDiskReads = numDiskWrites = 0;
+    numDiskReads = numDiskWrites = numDiskSeekTracks = 0;
+    numCacheHits = numCacheMisses = numCacheEvictions = 0;
+    numCacheReadAheads = 0;
     numConsoleCharsRead = numConsoleCharsWritten = 0;
     numPageFaults = numPacketsSent = numPacketsRecvd = 0;
+    hostStartTime = HostTime();
 }
 
 //----------------------------------------------------------------------
@@ -37,9 +40,25 @@ Statistics::Print()
 		cout << ", system " << systemTicks << ", user " << userTicks <<"\n";
     cout << "Disk I/O: reads " << numDiskReads;
 		cout << ", writes " << numDiskWrites << "\n";
+    if (numDiskReads + numDiskWrites > 0) {
+	cout << "Disk seeks: average distance ";
+		cout << (double) numDiskSeekTracks / (numDiskReads + numDiskWrites);
+		cout << " tracks\n";
+    }
+    cout << "Disk cache: hits " << numCacheHits;
+		cout << ", misses " << numCacheMisses;
+		cout << ", read-ahead " << numCacheReadAheads;
+		cout << ", evictions " << numCacheEvictions << "\n";
 		cout << "Console I/O: reads " << numConsoleCharsRead;
     cout << ", writes " << numConsoleCharsWritten << "\n";
     cout << "Paging: faults " << numPageFaults << "\n";
     cout << "Network I/O: packets received " << numPacketsRecvd;
 		cout << ", sent " << numPacketsSent << "\n";
+
+    double hostSeconds = HostTime() - hostStartTime;
+    cout << "Host time: " << hostSeconds << " seconds";
+    if (hostSeconds > 0)
+	cout << ", " << (int) (userTicks / hostSeconds) 
+		<< " user instructions per second";
+    cout << "\n";
 }
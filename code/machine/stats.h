@@ -30,11 +30,20 @@ class Statistics {
 
     int numDiskReads;		// number of disk read requests
     int numDiskWrites;		// number of disk write requests
+    int numDiskSeekTracks;	// total number of tracks the disk head
+				// moved across to reach each request
+    int numCacheHits;		// number of sector requests found in
+				// the disk buffer cache
+    int numCacheMisses;		// number of sector requests not found
+    int numCacheReadAheads;	// number of sectors read into the cache
+				// ahead of being asked for
+    int numCacheEvictions;	// number of sectors pushed out of the cache
     int numConsoleCharsRead;	// number of characters read from the keyboard
     int numConsoleCharsWritten; // number of characters written to the display
     int numPageFaults;		// number of virtual memory page faults
     int numPacketsSent;		// number of packets sent over the network
     int numPacketsRecvd;	// number of packets received over the network
+    double hostStartTime;	// real time on the host when Nachos started
 
     Statistics(); 		// initialize everything to zero
 
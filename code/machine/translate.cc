@@ -91,7 +91,7 @@ Machine::ReadMem(int addr, int size, int *value)
     
     DEBUG(dbgAddr, "Reading VA " << addr << ", size " << size);
     
-    exception = Translate(addr, &physicalAddress, size, FALSE);
+    exception = Translate(addr, &physicalAddress, size, ReadAccess);
     if (exception != NoException) {
 	RaiseException(exception, addr);
 	return FALSE;
@@ -140,7 +140,7 @@ Machine::WriteMem(int addr, int size, int value)
      
     DEBUG(dbgAddr, "Writing VA " << addr << ", size " << size << ", value " << value);
 
-    exception = Translate(addr, &physicalAddress, size, TRUE);
+    exception = Translate(addr, &physicalAddress, size, WriteAccess);
     if (exception != NoException) {
 	RaiseException(exception, addr);
 	return FALSE;
@@ -162,10 +162,143 @@ Machine::WriteMem(int addr, int size, int value)
 	
       default: ASSERT(FALSE);
     }
+    if (decodedPages[physicalAddress / PageSize] != NULL)	// code changed?
+	decodedPages[physicalAddress / PageSize]
+		[(physicalAddress % PageSize) / 4].decoded = FALSE;
     
     return TRUE;
 }
 
+//----------------------------------------------------------------------
+// Machine::ReadMemBlock
+//      Copy "size" bytes of virtual memory starting at "addr" into the
+//	kernel buffer "into".  Each virtual page is translated once, and
+//	the bytes on that page are copied with a single bcopy, so large
+//	system call buffers don't pay for a translation per byte.
+//
+//   	Returns FALSE if some page could not be translated.  Unlike
+//	ReadMem, no exception is raised -- the caller is kernel code,
+//	which reports the failure back to the user program itself.
+//
+//	"addr" -- the virtual address to read from
+//	"size" -- the number of bytes to read
+//	"into" -- the kernel buffer to copy into
+//----------------------------------------------------------------------
+
+bool
+Machine::ReadMemBlock(int addr, int size, char *into)
+{
+    int done, chunk, physicalAddress;
+
+    DEBUG(dbgAddr, "Reading block at VA " << addr << ", size " << size);
+
+    for (done = 0; done < size; done += chunk) {
+	chunk = min(PageSize - (int) ((unsigned) (addr + done) % PageSize), size - done);
+	if (Translate(addr + done, &physicalAddress, 1, ReadAccess) != NoException)
+	    return FALSE;
+	bcopy(&mainMemory[physicalAddress], &into[done], chunk);
+    }
+    return TRUE;
+}
+
+//----------------------------------------------------------------------
+// Machine::WriteMemBlock
+//      Copy "size" bytes from the kernel buffer "from" into virtual
+//	memory starting at "addr", one page at a time.
+//
+//   	Returns FALSE if some page could not be translated, or is
+//	read-only.  The bytes on earlier pages have already been written.
+//
+//	"addr" -- the virtual address to write to
+//	"size" -- the number of bytes to write
+//	"from" -- the kernel buffer to copy from
+//----------------------------------------------------------------------
+
+bool
+Machine::WriteMemBlock(int addr, int size, char *from)
+{
+    int done, chunk, physicalAddress;
+
+    DEBUG(dbgAddr, "Writing block at VA " << addr << ", size " << size);
+
+    for (done = 0; done < size; done += chunk) {
+	chunk = min(PageSize - (int) ((unsigned) (addr + done) % PageSize), size - done);
+	if (Translate(addr + done, &physicalAddress, 1, WriteAccess) != NoException)
+	    return FALSE;
+	bcopy(&from[done], &mainMemory[physicalAddress], chunk);
+	InvalidateInstructions(physicalAddress, chunk);
+    }
+    return TRUE;
+}
+
+//----------------------------------------------------------------------
+// Machine::ReadMemString
+//      Copy a '\0'-terminated string from virtual memory at "addr" into
+//	the kernel buffer "into", scanning and copying a page at a time.
+//	At most "maxSize" bytes are copied, including the '\0'; a longer
+//	string is truncated (and still '\0'-terminated).
+//
+//   	Returns the length of the copied string, or -1 if some page could
+//	not be translated.
+//
+//	"addr" -- the virtual address of the string
+//	"maxSize" -- the size of "into"
+//	"into" -- the kernel buffer to copy into
+//----------------------------------------------------------------------
+
+int
+Machine::ReadMemString(int addr, int maxSize, char *into)
+{
+    int done, chunk, physicalAddress;
+    char *end;
+
+    ASSERT(maxSize > 0);
+    DEBUG(dbgAddr, "Reading string at VA " << addr << ", max " << maxSize);
+
+    for (done = 0; done < maxSize; done += chunk) {
+	chunk = min(PageSize - (int) ((unsigned) (addr + done) % PageSize), maxSize - done);
+	if (Translate(addr + done, &physicalAddress, 1, ReadAccess) != NoException)
+	    return -1;
+	end = (char *) memchr(&mainMemory[physicalAddress], '\0', chunk);
+	if (end != NULL) {		// found the end of the string
+	    chunk = end - &mainMemory[physicalAddress] + 1;
+	    bcopy(&mainMemory[physicalAddress], &into[done], chunk);
+	    return done + chunk - 1;
+	}
+	bcopy(&mainMemory[physicalAddress], &into[done], chunk);
+    }
+    into[maxSize - 1] = '\0';		// too long, truncate
+    return maxSize - 1;
+}
+
+//----------------------------------------------------------------------
+// Machine::WriteMemString
+//      Copy the '\0'-terminated kernel string "from" into virtual
+//	memory at "addr".  At most "maxSize" bytes are written, including
+//	the '\0'; a longer string is truncated.
+//
+//   	Returns the length of the written string, or -1 if some page
+//	could not be translated, or is read-only.
+//
+//	"addr" -- the virtual address to write to
+//	"maxSize" -- the size of the user buffer at "addr"
+//	"from" -- the kernel string to copy
+//----------------------------------------------------------------------
+
+int
+Machine::WriteMemString(int addr, int maxSize, char *from)
+{
+    char terminator = '\0';
+    int length;
+
+    ASSERT(maxSize > 0);
+    length = min((int) strlen(from), maxSize - 1);
+    if (!WriteMemBlock(addr, length, from) 
+		|| !WriteMemBlock(addr + length, 1, &terminator))
+	return -1;
+    return length;
+}
+
 //----------------------------------------------------------------------
 // Machine::Translate
 // 	Translate a virtual address into a physical address, using 
@@ -178,16 +311,35 @@ Machine::WriteMem(int addr, int size, int value)
 //	"virtAddr" -- the virtual address to translate
 //	"physAddr" -- the place to store the physical address
 //	"size" -- the amount of memory being read or written
-// 	"writing" -- if TRUE, check the "read-only" bit in the TLB
+// 	"access" -- whether reading, writing (if so, check the "read-only"
+//		bit), or fetching an instruction
+//
+//	The last few successful translations for each kind of access are
+//	cached, indexed by virtual page.  An aligned access to one of
+//	those pages is translated with a compare and an add, skipping
+//	the checks below (and their debugging output): they all passed 
+//	the last time, the use bit is still set, and so is the dirty bit
+//	of a page that was written.  This is only true until the kernel
+//	changes the translation table, so it must call FlushTranslations
+//	when it does.
 //----------------------------------------------------------------------
 
 ExceptionType
-Machine::Translate(int virtAddr, int* physAddr, int size, bool writing)
+Machine::Translate(int virtAddr, int* physAddr, int size, AccessType access)
 {
     int i;
     unsigned int vpn, offset;
     TranslationEntry *entry;
     unsigned int pageFrame;
+    bool writing = (access == WriteAccess);
+    CachedTranslation *cached;
+
+    vpn = (unsigned) virtAddr / PageSize;
+    cached = &translations[access][vpn & (TranslationSlots - 1)];
+    if (cached->virtualPage == vpn && (virtAddr & (size - 1)) == 0) {
+	*physAddr = cached->frameAddr + (unsigned) virtAddr % PageSize;
+	return NoException;
+    }
 
     DEBUG(dbgAddr, "\tTranslate " << virtAddr << (writing ? " , write" : " , read"));
 
@@ -201,9 +353,7 @@ Machine::Translate(int virtAddr, int* physAddr, int size, bool writing)
     ASSERT(tlb == NULL || pageTable == NULL);	
     ASSERT(tlb != NULL || pageTable != NULL);	
 
-// calculate the virtual page number, and offset within the page,
-// from the virtual address
-    vpn = (unsigned) virtAddr / PageSize;
+// calculate the offset within the page from the virtual address
     offset = (unsigned) virtAddr % PageSize;
     
     if (tlb == NULL) {		// => page table => vpn is index into table
@@ -247,5 +397,7 @@ Machine::Translate(int virtAddr, int* physAddr, int size, bool writing)
     *physAddr = pageFrame * PageSize + offset;
     ASSERT((*physAddr >= 0) && ((*physAddr + size) <= MemorySize));
     DEBUG(dbgAddr, "phys addr = " << *physAddr);
+    cached->virtualPage = vpn;		// remember it, for next time
+    cached->frameAddr = pageFrame * PageSize;
     return NoException;
 }
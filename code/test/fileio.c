@@ -0,0 +1,48 @@
+/* fileio.c
+ *	Simple program to test whether the systemcalls Create, Write,
+ *	Seek and Remove work, together with Open, Read and Close.
+ *
+ *	Creates a file, writes a string into it, seeks back to the
+ *	start, reads the string back and prints it, then removes the file.
+ */
+
+#include "syscall.h"
+
+int main()
+{
+    char *name = "fileio.txt";
+    char *msg = "Hello from fileio!\n";
+    char buffer[64];
+    OpenFileId id;
+    int len, n;
+
+    for (len = 0; msg[len] != '\0'; len++)
+        ;
+
+    if (Create(name) == -1) {
+        PrintString("Create failed\n");
+        Halt();
+    }
+
+    id = Open(name);
+    if (id == -1) {
+        PrintString("Open failed\n");
+        Halt();
+    }
+
+    n = Write(msg, len, id);
+    PrintString("Bytes written: ");
+    PrintNum(n);
+    PrintChar('\n');
+
+    Seek(0, id);
+    n = Read(buffer, sizeof(buffer) - 1, id);
+    buffer[n > 0 ? n : 0] = '\0';
+    Write(buffer, n, _ConsoleOutput);
+
+    Close(id);
+    Remove(name);
+
+    Halt();
+  /* not reached */
+}
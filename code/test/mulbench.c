@@ -0,0 +1,188 @@
+/* mulbench.c
+ *	Test program to check, and time, the simulated multiply and
+ *	divide instructions (MULT, MULTU, DIV, DIVU).
+ *
+ *	The results of the hardware instructions, in both HI and LO, are
+ *	checked bit for bit against shift-and-add multiplication and
+ *	shift-and-subtract division done in software, over a stream of
+ *	pseudo-random operands, and for the divisor -1, which the
+ *	compiler does not let a plain "/" reach.  Then a loop of 
+ *	multiplies and divides is run for timing.
+ *
+ *	Nachos prints the simulated time (ticks) and the real time the
+ *	host took when the program halts.
+ */
+
+#include "syscall.h"
+
+#define NumChecks	2000	/* operand pairs checked */
+#define NumTimed	20000	/* operand pairs in the timing loop */
+
+unsigned seed = 0x2545f491;
+
+/* Random -- xorshift, so no multiplies are used to make operands */
+unsigned
+Random()
+{
+    seed ^= seed << 13;
+    seed ^= seed >> 17;
+    seed ^= seed << 5;
+    return seed;
+}
+
+/* SoftMultU -- 64-bit product of a and b, one bit of a at a time */
+void
+SoftMultU(unsigned a, unsigned b, unsigned *hi, unsigned *lo)
+{
+    unsigned bLo = b, bHi = 0;
+
+    *hi = *lo = 0;
+    while (a != 0) {
+	if (a & 1) {
+	    *lo += bLo;
+	    if (*lo < bLo)		/* carry out of the low word */
+		*hi += 1;
+	    *hi += bHi;
+	}
+	bHi = (bHi << 1) | (bLo >> 31);
+	bLo <<= 1;
+	a >>= 1;
+    }
+}
+
+/* SoftMult -- signed 64-bit product: multiply the magnitudes, negate */
+void
+SoftMult(int a, int b, unsigned *hi, unsigned *lo)
+{
+    int negative = (a < 0) != (b < 0);
+
+    SoftMultU(a < 0 ? -(unsigned) a : a, b < 0 ? -(unsigned) b : b, hi, lo);
+    if (negative) {
+	*hi = ~*hi;
+	*lo = ~*lo + 1;
+	if (*lo == 0)
+	    *hi += 1;
+    }
+}
+
+/* SoftDivU -- quotient and remainder of a / b, one bit at a time */
+void
+SoftDivU(unsigned a, unsigned b, unsigned *quo, unsigned *rem)
+{
+    int i;
+
+    *quo = *rem = 0;
+    for (i = 31; i >= 0; i--) {
+	*rem = (*rem << 1) | ((a >> i) & 1);
+	if (*rem >= b) {
+	    *rem -= b;
+	    *quo |= 1 << i;
+	}
+    }
+}
+
+/* SoftDiv -- signed division, rounding towards zero */
+void
+SoftDiv(int a, int b, unsigned *quo, unsigned *rem)
+{
+    SoftDivU(a < 0 ? -(unsigned) a : a, b < 0 ? -(unsigned) b : b, quo, rem);
+    if ((a < 0) != (b < 0))
+	*quo = -*quo;
+    if (a < 0)
+	*rem = -*rem;
+}
+
+/* HardDiv -- signed division by the DIV instruction itself.  For "/"
+ * and "%", the compiler adds checks that trap when b is 0, or when
+ * a is INT_MIN and b is -1; here nothing stands in front of the DIV.
+ */
+void
+HardDiv(int a, int b, unsigned *quo, unsigned *rem)
+{
+    unsigned lo, hi;
+
+    asm volatile ("div $0,%2,%3\n\tmflo %0\n\tmfhi %1"
+		  : "=r" (lo), "=r" (hi) : "r" (a), "r" (b));
+    *quo = lo;
+    *rem = hi;
+}
+
+int errors = 0;
+
+void
+Check(char *op, unsigned a, unsigned b, unsigned got, unsigned want)
+{
+    if (got == want)
+	return;
+    errors++;
+    PrintString(op);
+    PrintString(": ");
+    PrintNum(a);
+    PrintString(", ");
+    PrintNum(b);
+    PrintString(" gave ");
+    PrintNum(got);
+    PrintString(" instead of ");
+    PrintNum(want);
+    PrintString("\n");
+}
+
+int
+main()
+{
+    int i, a, b;
+    unsigned hi, lo, quo, rem, sum;
+
+    /* the one quotient that overflows: LO = INT_MIN, HI = 0 */
+    a = 1 << 31;
+    HardDiv(a, -1, &quo, &rem);
+    Check("div quo", a, -1, quo, a);
+    Check("div rem", a, -1, rem, 0);
+
+    for (i = 0; i < NumChecks; i++) {
+	a = Random();
+	b = Random();
+	if (i & 1)			/* mix in small operands */
+	    b >>= 20 + (i & 7);
+
+	SoftMult(a, b, &hi, &lo);
+	Check("mult lo", a, b, a * b, lo);
+	Check("mult hi", a, b, ((long long) a * b) >> 32, hi);
+
+	SoftMultU(a, b, &hi, &lo);
+	Check("multu lo", a, b, (unsigned) a * (unsigned) b, lo);
+	Check("multu hi", a, b,
+		((unsigned long long) (unsigned) a * (unsigned) b) >> 32, hi);
+
+	if (b == 0)			/* the result is undefined */
+	    continue;
+	SoftDiv(a, b, &lo, &hi);
+	HardDiv(a, b, &quo, &rem);
+	Check("div quo", a, b, quo, lo);
+	Check("div rem", a, b, rem, hi);
+	SoftDiv(a, -1, &lo, &hi);
+	HardDiv(a, -1, &quo, &rem);
+	Check("div quo", a, -1, quo, lo);
+	Check("div rem", a, -1, rem, hi);
+
+	SoftDivU(a, b, &lo, &hi);
+	Check("divu quo", a, b, (unsigned) a / (unsigned) b, lo);
+	Check("divu rem", a, b, (unsigned) a % (unsigned) b, hi);
+    }
+    PrintString("mulbench: ");
+    PrintNum(errors);
+    PrintString(" errors\n");
+
+    sum = 0;
+    for (i = 0; i < NumTimed; i++) {
+	a = Random();
+	b = (Random() >> 8) | 1;
+	sum += a * b + (unsigned) a / (unsigned) b + a % b;
+    }
+    PrintString("mulbench: checksum ");
+    PrintNum(sum);
+    PrintString("\n");
+
+    Halt();
+    /* not reached */
+}
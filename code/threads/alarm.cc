@@ -11,6 +11,7 @@
 #include "copyright.h"
 #include "alarm.h"
 #include "main.h"
+#include "synchdisk.h"
 
 //----------------------------------------------------------------------
 // Alarm::Alarm
@@ -41,6 +42,7 @@ Alarm::Alarm(bool doRandom)
 //
 //	For now, just provide time-slicing.  Only need to time slice 
 //      if we're currently running something (in other words, not idle).
+//	The disk cache also gets a tick, to write dirty sectors behind.
 //----------------------------------------------------------------------
 
 void 
@@ -52,4 +54,6 @@ Alarm::CallBack()
     if (status != IdleMode) {
 	interrupt->YieldOnReturn();
     }
+    if (kernel->synchDisk != NULL)
+	kernel->synchDisk->Tick();
 }
@@ -16,6 +16,7 @@
 #include "string.h"
 #include "synchconsole.h"
 #include "synchdisk.h"
+#include "filetable.h"
 #include "post.h"
 
 //----------------------------------------------------------------------
@@ -28,14 +29,18 @@ Kernel::Kernel(int argc, char **argv)
 {
     randomSlice = FALSE; 
     debugUserProg = FALSE;
+    blockUserProg = FALSE;
     consoleIn = NULL;          // default is stdin
     consoleOut = NULL;         // default is stdout
+    diskPolicy = DiskCLOOK;
 #ifndef FILESYS_STUB
     formatFlag = FALSE;
 #endif
     reliability = 1;            // network reliability, default is 1.0
     hostName = 0;               // machine id, also UNIX socket name
                                 // 0 is the default machine id
+    mapDisk = FALSE;
+    diskTracks = diskSectorsPerTrack = 0;
     for (int i = 1; i < argc; i++) {
         if (strcmp(argv[i], "-rs") == 0) {
  	    ASSERT(i + 1 < argc);
@@ -45,6 +50,8 @@ Kernel::Kernel(int argc, char **argv)
 	    i++;
         } else if (strcmp(argv[i], "-s") == 0) {
             debugUserProg = TRUE;
+	} else if (strcmp(argv[i], "-b") == 0) {
+	    blockUserProg = TRUE;
 	} else if (strcmp(argv[i], "-ci") == 0) {
 	    ASSERT(i + 1 < argc);
 	    consoleIn = argv[i + 1];
@@ -53,10 +60,32 @@ Kernel::Kernel(int argc, char **argv)
 	    ASSERT(i + 1 < argc);
 	    consoleOut = argv[i + 1];
 	    i++;
+	} else if (strcmp(argv[i], "-ds") == 0) {
+	    ASSERT(i + 1 < argc);
+	    if (strcmp(argv[i + 1], "fifo") == 0)
+		diskPolicy = DiskFIFO;
+	    else if (strcmp(argv[i + 1], "sstf") == 0)
+		diskPolicy = DiskSSTF;
+	    else if (strcmp(argv[i + 1], "clook") == 0)
+		diskPolicy = DiskCLOOK;
+	    else
+		ASSERT(FALSE);		// unknown disk scheduling policy
+	    i++;
+	} else if (strcmp(argv[i], "-dm") == 0) {
+	    mapDisk = TRUE;
 #ifndef FILESYS_STUB
 	} else if (strcmp(argv[i], "-f") == 0) {
 	    formatFlag = TRUE;
 #endif
+	} else if (strcmp(argv[i], "-geom") == 0) {
+	    ASSERT(i + 2 < argc);   // number of tracks, sectors per track
+	    diskTracks = atoi(argv[i + 1]);
+	    diskSectorsPerTrack = atoi(argv[i + 2]);
+	    ASSERT((diskTracks > 0) && (diskSectorsPerTrack > 0));
+#ifndef FILESYS_STUB
+	    formatFlag = TRUE;	// a new disk has to be formatted
+#endif
+	    i += 2;
         } else if (strcmp(argv[i], "-n") == 0) {
             ASSERT(i + 1 < argc);   // next argument is float
             reliability = atof(argv[i + 1]);
@@ -67,11 +96,13 @@ Kernel::Kernel(int argc, char **argv)
             i++;
         } else if (strcmp(argv[i], "-u") == 0) {
             cout << "Partial usage: nachos [-rs randomSeed]\n";
-	    cout << "Partial usage: nachos [-s]\n";
+	    cout << "Partial usage: nachos [-s] [-b]\n";
             cout << "Partial usage: nachos [-ci consoleIn] [-co consoleOut]\n";
+	    cout << "Partial usage: nachos [-ds fifo|sstf|clook] [-dm]\n";
 #ifndef FILESYS_STUB
 	    cout << "Partial usage: nachos [-nf]\n";
 #endif
+	    cout << "Partial usage: nachos [-geom numTracks sectorsPerTrack]\n";
             cout << "Partial usage: nachos [-n #] [-m #]\n";
 	}
     }
@@ -97,13 +128,14 @@ Kernel::Initialize()
     interrupt = new Interrupt;		// start up interrupt handling
     scheduler = new Scheduler();	// initialize the ready queue
     alarm = new Alarm(randomSlice);	// start up time slicing
-    machine = new Machine(debugUserProg);
+    machine = new Machine(debugUserProg, blockUserProg);
     synchConsoleIn = new SynchConsoleInput(consoleIn); // input from stdin
     synchConsoleOut = new SynchConsoleOutput(consoleOut); // output to stdout
-    synchDisk = new SynchDisk();    //
+    synchDisk = new SynchDisk(diskPolicy);    //
 #ifdef FILESYS_STUB
     fileSystem = new FileSystem();
 #else
+    openFileTable = new OpenFileTable();
     fileSystem = new FileSystem(formatFlag);
 #endif // FILESYS_STUB
     postOfficeIn = new PostOfficeInput(10);
@@ -128,6 +160,9 @@ Kernel::~Kernel()
     delete synchConsoleOut;
     delete synchDisk;
     delete fileSystem;
+#ifndef FILESYS_STUB
+    delete openFileTable;
+#endif
     delete postOfficeIn;
     delete postOfficeOut;
     
@@ -18,12 +18,14 @@
 #include "alarm.h"
 #include "filesys.h"
 #include "machine.h"
+#include "disk.h"
 
 class PostOfficeInput;
 class PostOfficeOutput;
 class SynchConsoleInput;
 class SynchConsoleOutput;
 class SynchDisk;
+class OpenFileTable;
 
 class Kernel {
   public:
@@ -53,21 +55,31 @@ class Kernel {
     SynchConsoleInput *synchConsoleIn;
     SynchConsoleOutput *synchConsoleOut;
     SynchDisk *synchDisk;
+#ifndef FILESYS_STUB
+    OpenFileTable *openFileTable;	// headers of the files now open
+#endif
     FileSystem *fileSystem;     
     PostOfficeInput *postOfficeIn;
     PostOfficeOutput *postOfficeOut;
 
     int hostName;               // machine identifier
+    bool mapDisk;		// serve the simulated disk from a 
+				// memory-mapped UNIX file
+    int diskTracks;		// geometry for a new disk ("-geom"),
+    int diskSectorsPerTrack;	// or 0 to use the existing one
+#ifndef FILESYS_STUB
+    bool formatFlag;          // format the disk if this is true
+#endif
 
   private:
     bool randomSlice;		// enable pseudo-random time slicing
     bool debugUserProg;         // single step user program
+    bool blockUserProg;		// run user program a basic block at a time
     double reliability;         // likelihood messages are dropped
     char *consoleIn;            // file to read console input from
     char *consoleOut;           // file to send console output to
-#ifndef FILESYS_STUB
-    bool formatFlag;          // format the disk if this is true
-#endif
+    DiskPolicy diskPolicy;	// order in which queued disk requests
+				// are served
 };
 
 
@@ -3,9 +3,9 @@
 //	operating system kernel.  
 //
 // Usage: nachos -d <debugflags> -rs <random seed #>
-//              -s -x <nachos file> -ci <consoleIn> -co <consoleOut>
+//              -s -b -x <nachos file> -ci <consoleIn> -co <consoleOut>
 //              -f -cp <unix file> <nachos file>
-//              -p <nachos file> -r <nachos file> -l -D
+//              -p <nachos file> -r <nachos file> -mkdir <nachos dir> -l -D
 //              -n <network reliability> -m <machine id>
 //              -z -K -C -N
 //
@@ -13,6 +13,8 @@
 //    -rs causes Yield to occur at random (but repeatable) spots
 //    -z prints the copyright message
 //    -s causes user programs to be executed in single-step mode
+//    -b causes user programs to be executed a basic block at a time,
+//	 checking for interrupts only between blocks (faster)
 //    -x runs a user program
 //    -ci specify file for console input (stdin is the default)
 //    -co specify file for console output (stdout is the default)
@@ -26,8 +28,9 @@
 //    -f forces the Nachos disk to be formatted
 //    -cp copies a file from UNIX to Nachos
 //    -p prints a Nachos file to stdout
-//    -r removes a Nachos file from the file system
-//    -l lists the contents of the Nachos directory
+//    -r removes a Nachos file (or empty directory) from the file system
+//    -mkdir creates a Nachos directory
+//    -l lists the contents of the Nachos directories
 //    -D prints the contents of the entire file system 
 //
 //  Note: the file system flags are not used if the stub filesystem
@@ -177,6 +180,7 @@ main(int argc, char **argv)
     char *copyNachosFileName = NULL;  // name of copied file in Nachos
     char *printFileName = NULL; 
     char *removeFileName = NULL;
+    char *makeDirName = NULL;
     bool dirListFlag = false;
     bool dumpFlag = false;
 #endif //FILESYS_STUB
@@ -224,6 +228,11 @@ main(int argc, char **argv)
 	    removeFileName = argv[i + 1];
 	    i++;
 	}
+	else if (strcmp(argv[i], "-mkdir") == 0) {
+	    ASSERT(i + 1 < argc);
+	    makeDirName = argv[i + 1];
+	    i++;
+	}
 	else if (strcmp(argv[i], "-l") == 0) {
 	    dirListFlag = true;
 	}
@@ -238,6 +247,7 @@ main(int argc, char **argv)
 #ifndef FILESYS_STUB
             cout << "Partial usage: nachos [-cp UnixFile NachosFile]\n";
             cout << "Partial usage: nachos [-p fileName] [-r fileName]\n";
+            cout << "Partial usage: nachos [-mkdir dirName]\n";
             cout << "Partial usage: nachos [-l] [-D]\n";
 #endif //FILESYS_STUB
 	}
@@ -269,6 +279,9 @@ main(int argc, char **argv)
     if (removeFileName != NULL) {
       kernel->fileSystem->Remove(removeFileName);
     }
+    if (makeDirName != NULL) {
+      kernel->fileSystem->CreateDirectory(makeDirName);
+    }
     if (copyUnixFileName != NULL && copyNachosFileName != NULL) {
       Copy(copyUnixFileName,copyNachosFileName);
     }
@@ -79,16 +79,21 @@ AddrSpace::AddrSpace()
     
     // zero out the entire address space
     bzero(kernel->machine->mainMemory, MemorySize);
+    kernel->machine->InvalidateInstructions(0, MemorySize);
+
+    fileTable = new FileDescriptorTable();
 }
 
 //----------------------------------------------------------------------
 // AddrSpace::~AddrSpace
-// 	Dealloate an address space.
+// 	Dealloate an address space, closing any files the program
+//	left open.
 //----------------------------------------------------------------------
 
 AddrSpace::~AddrSpace()
 {
-   delete pageTable;
+   delete [] pageTable;
+   delete fileTable;
 }
 
 
@@ -150,6 +155,8 @@ AddrSpace::Load(char *fileName)
         executable->ReadAt(
 		&(kernel->machine->mainMemory[noffH.code.virtualAddr]), 
 			noffH.code.size, noffH.code.inFileAddr);
+	kernel->machine->InvalidateInstructions(
+		noffH.code.virtualAddr, noffH.code.size);
     }
     if (noffH.initData.size > 0) {
         DEBUG(dbgAddr, "Initializing data segment.");
@@ -157,6 +164,8 @@ AddrSpace::Load(char *fileName)
         executable->ReadAt(
 		&(kernel->machine->mainMemory[noffH.initData.virtualAddr]),
 			noffH.initData.size, noffH.initData.inFileAddr);
+	kernel->machine->InvalidateInstructions(
+		noffH.initData.virtualAddr, noffH.initData.size);
     }
 
 #ifdef RDATA
@@ -166,6 +175,8 @@ AddrSpace::Load(char *fileName)
         executable->ReadAt(
 		&(kernel->machine->mainMemory[noffH.readonlyData.virtualAddr]),
 			noffH.readonlyData.size, noffH.readonlyData.inFileAddr);
+	kernel->machine->InvalidateInstructions(
+		noffH.readonlyData.virtualAddr, noffH.readonlyData.size);
     }
 #endif
 
@@ -258,6 +269,7 @@ void AddrSpace::RestoreState()
 {
     kernel->machine->pageTable = pageTable;
     kernel->machine->pageTableSize = numPages;
+    kernel->machine->FlushTranslations();
 }
 
 
@@ -62,11 +62,7 @@ void CopyStringOSToUser(char *str, int addr, int copy_len = -1)
 	{
 		copy_len = strlen(str);
 	}
-	for (int i = 0; i < copy_len; i++)
-	{
-		kernel->machine->WriteMem(addr + i, 1, str[i]);
-	}
-	kernel->machine->WriteMem(addr + copy_len, 1, '\0');
+	kernel->machine->WriteMemString(addr, copy_len + 1, str);
 }
 
 /**
@@ -106,29 +102,59 @@ void CopyStringOSToUser(char *str, int addr, int copy_len = -1)
 // }
 char *CopyStringUserToOS(int addr)
 {
-	int len = 0;
-	bool stop = false;
+	int size = PageSize;
 	char *str;
 
-	do
+	// copy at most "size" bytes; if the string did not fit,
+	// try again with a buffer twice as large
+	for (;;)
 	{
-		int oneChar;
-		kernel->machine->ReadMem(addr + len, 1, &oneChar);
-		len++;
-		// if copy_length == -1, we use '\0' to terminate the process
-		// otherwise, we use copy_length to terminate the process
-		stop = (oneChar == '\0');
-	} while (!stop);
-
-	str = new char[len];
-	for (int i = 0; i < len; i++)
+		str = new char[size];
+		int len = kernel->machine->ReadMemString(addr, size, str);
+		if (len == -1)
+		{
+			str[0] = '\0';	// unmapped address, return empty string
+			return str;
+		}
+		if (len < size - 1)
+			return str;
+		delete[] str;
+		size *= 2;
+	}
+}
+
+/**
+ * @brief Copy a user buffer to a new system buffer
+ *
+ * @param addr address of user buffer
+ * @param size number of bytes to copy
+ * @return char* (NULL if part of the buffer is not mapped)
+ */
+char *CopyBufferUserToOS(int addr, int size)
+{
+	char *buffer = new char[size + 1];
+
+	if (!kernel->machine->ReadMemBlock(addr, size, buffer))
 	{
-		int oneChar;
-		kernel->machine->ReadMem(addr + i, 1,
-								 &oneChar); // copy characters to kernel space
-		str[i] = (unsigned char)oneChar;
+		delete[] buffer;
+		return NULL;
 	}
-	return str;
+	buffer[size] = '\0';
+	return buffer;
+}
+
+/**
+ * @brief Copy a system buffer to a user buffer
+ *
+ * @param buffer system buffer to copy
+ * @param addr address of user buffer
+ * @param size number of bytes to copy
+ * @return true if all bytes were copied, false if part of the user
+ * buffer is not mapped or is read-only
+ */
+bool CopyBufferOSToUser(char *buffer, int addr, int size)
+{
+	return kernel->machine->WriteMemBlock(addr, size, buffer);
 }
 
 //----------------------------------------------------------------------
@@ -274,6 +300,10 @@ void Handle_SC_PrintChar()
 	UpdateProgramCounter();
 }
 
+/**
+ * @brief Process when System call Open is called
+ * @return void
+ */
 void Handle_SC_Open()
 {
 	int buffAddr = kernel->machine->ReadRegister(4);
@@ -282,70 +312,179 @@ void Handle_SC_Open()
 
 	OpenFileId result = SysOpenFile(buffer);
 
-	if (result == 0)
+	if (result != -1)
 	{
-		DEBUG(dbgSys, "[Debug] Open file " << buffer << " at address " << kernel->fileSystem->openf[result] << " complete !!! \n");
-		kernel->machine->WriteRegister(2, result);
+		DEBUG(dbgSys, "[Debug] Open file " << buffer << " as descriptor " << result << " complete !!! \n");
 	}
-	else if(result == -1)
+	else
 	{
-		DEBUG(dbgSys, "[Debug] Can not open file " << buffer << " at address "<< kernel->fileSystem->openf[result] << "\n");
-		kernel->machine->WriteRegister(2, -1);
+		DEBUG(dbgSys, "[Debug] Can not open file " << buffer << "\n");
 	}
+	kernel->machine->WriteRegister(2, result);
 	delete[] buffer;
 
 	UpdateProgramCounter();
 }
 
+/**
+ * @brief Process when System call Close is called
+ * @return void
+ */
 void Handle_SC_Close()
 {
 	int id = kernel->machine->ReadRegister(4);
-	OpenFile* fileAddr = kernel->fileSystem->openf[id];
 
 	int result = SysCloseFile(id);
 	if (result == 0)
 	{
-		DEBUG(dbgSys, "[Debug] Closed file at address " << fileAddr << " !!! \n");
-		kernel->machine->WriteRegister(2, 0);
+		DEBUG(dbgSys, "[Debug] Closed file descriptor " << id << " !!! \n");
 	}
-	else if(result == -1) {
-		DEBUG(dbgSys, "[Debug] File at address " << kernel->fileSystem->openf[id] <<" is not open !!! \n");
-		kernel->machine->WriteRegister(2, -1);
+	else
+	{
+		DEBUG(dbgSys, "[Debug] File descriptor " << id << " is not open !!! \n");
 	}
+	kernel->machine->WriteRegister(2, result);
 	UpdateProgramCounter();
 }
 
+/**
+ * @brief Process when System call Read is called
+ * @return void
+ */
 void Handle_SC_Read() {
 	// Lấy giá trị tham số
 	int bufAddr = kernel->machine->ReadRegister(4);
 	int sizeBuf = kernel->machine->ReadRegister(5);
 	OpenFileId fileId = kernel->machine->ReadRegister(6);
 
-	// Kiểm tra OpenFileId có tồn tại không
-	bool isOpen = SysCheckOpenFileId(fileId);
+	int numRead = -1;
 
-	// Nếu OpenFileId có tồn tại hay file đang mở thì đọc nội dung file
-	if (isOpen) {		
+	if (sizeBuf >= 0) {
 		// Khởi tạo biến chuổi trong vùng Os
-		char *buffer = new char[sizeBuf];
+		char *buffer = new char[sizeBuf + 1];
 
-		// Đọc file với size tối đa
-		int numRead = kernel->fileSystem->openf[fileId]->Read(buffer,sizeBuf);
+		// Đọc file (hoặc console) với size tối đa
+		numRead = SysReadFile(buffer, sizeBuf, fileId);
 
 		// Copy vào chuỗi vào vùng của User
-		CopyStringOSToUser(buffer,bufAddr);
+		if (numRead > 0 && !CopyBufferOSToUser(buffer, bufAddr, numRead))
+			numRead = -1;
 
 		// Giải phóng bộ nhớ đã cấp phát
-		delete buffer;
-
-		// Trả về giá trị
-		kernel->machine->WriteRegister(2, numRead);
+		delete[] buffer;
 	}
+
+	DEBUG(dbgSys, "[Debug] Read " << numRead << " bytes from file descriptor " << fileId << "\n");
+
+	// Trả về giá trị
+	kernel->machine->WriteRegister(2, numRead);
+
 	// Đến lệnh tiếp theo
 	UpdateProgramCounter();
 }
 
 
+/**
+ * @brief Process when System call Write is called
+ * @return void
+ */
+void Handle_SC_Write()
+{
+	int bufAddr = kernel->machine->ReadRegister(4);
+	int sizeBuf = kernel->machine->ReadRegister(5);
+	OpenFileId fileId = kernel->machine->ReadRegister(6);
+
+	int numWrite = -1;
+
+	if (sizeBuf >= 0)
+	{
+		// copy the whole user buffer at once, page by page
+		char *buffer = CopyBufferUserToOS(bufAddr, sizeBuf);
+
+		if (buffer != NULL)
+		{
+			numWrite = SysWriteFile(buffer, sizeBuf, fileId);
+			delete[] buffer;
+		}
+	}
+
+	DEBUG(dbgSys, "[Debug] Wrote " << numWrite << " bytes to file descriptor " << fileId << "\n");
+	kernel->machine->WriteRegister(2, numWrite);
+
+	UpdateProgramCounter();
+}
+
+/**
+ * @brief Process when System call Seek is called
+ * @return void
+ */
+void Handle_SC_Seek()
+{
+	int position = kernel->machine->ReadRegister(4);
+	OpenFileId fileId = kernel->machine->ReadRegister(5);
+
+	int result = SysSeekFile(position, fileId);
+
+	DEBUG(dbgSys, "[Debug] Seek file descriptor " << fileId << " to " << result << "\n");
+	kernel->machine->WriteRegister(2, result);
+
+	UpdateProgramCounter();
+}
+
+/**
+ * @brief Process when System call Flush is called
+ * @return void
+ */
+void Handle_SC_Flush()
+{
+	OpenFileId fileId = kernel->machine->ReadRegister(4);
+
+	int result = SysFlushFile(fileId);
+
+	DEBUG(dbgSys, "[Debug] Flush file descriptor " << fileId << " returned " << result << "\n");
+	kernel->machine->WriteRegister(2, result);
+
+	UpdateProgramCounter();
+}
+
+/**
+ * @brief Process when System call Create is called
+ * @return void
+ */
+void Handle_SC_Create()
+{
+	int buffAddr = kernel->machine->ReadRegister(4);
+
+	char *buffer = CopyStringUserToOS(buffAddr);
+
+	int result = SysCreateFile(buffer);
+
+	DEBUG(dbgSys, "[Debug] Create file " << buffer << " returned " << result << "\n");
+	kernel->machine->WriteRegister(2, result);
+	delete[] buffer;
+
+	UpdateProgramCounter();
+}
+
+/**
+ * @brief Process when System call Remove is called
+ * @return void
+ */
+void Handle_SC_Remove()
+{
+	int buffAddr = kernel->machine->ReadRegister(4);
+
+	char *buffer = CopyStringUserToOS(buffAddr);
+
+	int result = SysRemoveFile(buffer);
+
+	DEBUG(dbgSys, "[Debug] Remove file " << buffer << " returned " << result << "\n");
+	kernel->machine->WriteRegister(2, result);
+	delete[] buffer;
+
+	UpdateProgramCounter();
+}
+
 void Handle_SC_Halt()
 {
 	DEBUG(dbgSys, "[Debug] Shutdown, initiated by user program.\n");
@@ -506,6 +645,21 @@ void ExceptionHandler(ExceptionType which)
 		case SC_Read:
 			return Handle_SC_Read();
 
+		case SC_Write:
+			return Handle_SC_Write();
+
+		case SC_Seek:
+			return Handle_SC_Seek();
+
+		case SC_Flush:
+			return Handle_SC_Flush();
+
+		case SC_Create:
+			return Handle_SC_Create();
+
+		case SC_Remove:
+			return Handle_SC_Remove();
+
 		default:
 			cerr << "Unexpected system call " << type << "\n";
 			break;
@@ -0,0 +1,107 @@
+// fdtable.cc
+//	Routines to manage the per-process table of open file descriptors.
+//
+//	The unused descriptor numbers are kept on a stack (freeList), so
+//	that Add pops a number and Remove pushes it back, each in
+//	constant time.
+
+#include "copyright.h"
+#include "debug.h"
+#include "fdtable.h"
+
+//----------------------------------------------------------------------
+// FileDescriptorTable::FileDescriptorTable
+// 	Initialize an empty descriptor table.  Every descriptor except
+//	the reserved console ones starts out on the free stack, pushed
+//	in reverse order so that the lowest numbers are handed out first.
+//
+//	"size" is the total number of descriptors, console included
+//----------------------------------------------------------------------
+
+FileDescriptorTable::FileDescriptorTable(int size)
+{
+    ASSERT(size > NumReservedFiles);
+
+    tableSize = size;
+    table = new OpenFile*[tableSize];
+    freeList = new int[tableSize];
+    numFree = 0;
+    for (int i = 0; i < tableSize; i++)
+	table[i] = NULL;
+    for (int fd = tableSize - 1; fd >= NumReservedFiles; fd--)
+	freeList[numFree++] = fd;
+}
+
+//----------------------------------------------------------------------
+// FileDescriptorTable::~FileDescriptorTable
+// 	Close every file that is still open, and de-allocate the table.
+//----------------------------------------------------------------------
+
+FileDescriptorTable::~FileDescriptorTable()
+{
+    for (int i = NumReservedFiles; i < tableSize; i++)
+	if (table[i] != NULL)
+	    delete table[i];
+    delete [] table;
+    delete [] freeList;
+}
+
+//----------------------------------------------------------------------
+// FileDescriptorTable::Add
+// 	Install an open file in the table.  Return its descriptor, or
+//	-1 if every descriptor is already in use.  The table takes
+//	ownership of "file", and deletes it when the descriptor is removed.
+//
+//	"file" -- the open file to install
+//----------------------------------------------------------------------
+
+int
+FileDescriptorTable::Add(OpenFile *file)
+{
+    int fd;
+
+    ASSERT(file != NULL);
+    if (numFree == 0)
+	return -1;			// table is full
+    fd = freeList[--numFree];
+    ASSERT(table[fd] == NULL);
+    table[fd] = file;
+    return fd;
+}
+
+//----------------------------------------------------------------------
+// FileDescriptorTable::Get
+// 	Return the open file for a descriptor, or NULL if the descriptor
+//	is out of range, is a console descriptor, or is not open.
+//
+//	"fd" -- the descriptor to look up
+//----------------------------------------------------------------------
+
+OpenFile *
+FileDescriptorTable::Get(int fd)
+{
+    if (fd < NumReservedFiles || fd >= tableSize)
+	return NULL;
+    return table[fd];
+}
+
+//----------------------------------------------------------------------
+// FileDescriptorTable::Remove
+// 	Close the file open as "fd" and return the descriptor to the
+//	free stack.  Return FALSE if "fd" was not an open file.
+//
+//	"fd" -- the descriptor to close
+//----------------------------------------------------------------------
+
+bool
+FileDescriptorTable::Remove(int fd)
+{
+    OpenFile *file = Get(fd);
+
+    if (file == NULL)
+	return FALSE;
+    delete file;
+    table[fd] = NULL;
+    freeList[numFree++] = fd;
+    return TRUE;
+}
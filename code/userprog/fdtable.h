@@ -0,0 +1,54 @@
+// fdtable.h
+//	Data structures for a per-process table of open file descriptors.
+//
+//	Each address space owns one table.  A user program refers to an
+//	open file by a small integer (an OpenFileId); the table maps that
+//	integer to the kernel OpenFile object.  Descriptors 0 and 1 are
+//	reserved for the console (see _ConsoleInput and _ConsoleOutput in
+//	syscall.h) and are never handed out by Add.
+//
+//	Free descriptor numbers are kept on a stack, so both allocating
+//	and freeing a descriptor take constant time regardless of the
+//	table size.
+
+#ifndef FDTABLE_H
+#define FDTABLE_H
+
+#include "copyright.h"
+#include "openfile.h"
+
+#define MaxOpenFiles		20	// default number of descriptors per
+					// process, including the console
+#define NumReservedFiles	2	// descriptors 0 and 1 are the console
+
+// The following class defines a table of open file descriptors.
+// Descriptors handed out by Add stay valid until Remove is called,
+// or until the table itself is deleted, which closes every file that
+// is still open.
+
+class FileDescriptorTable {
+  public:
+    FileDescriptorTable(int size = MaxOpenFiles);
+					// Initialize an empty table with
+					// room for "size" descriptors
+    ~FileDescriptorTable();		// Close all open files, de-allocate
+
+    int Add(OpenFile *file);		// Install "file", return its
+					// descriptor, or -1 if the table
+					// is full
+    OpenFile *Get(int fd);		// Return the file open as "fd", or
+					// NULL if "fd" is not an open file
+    bool Remove(int fd);		// Close "fd" and free its slot;
+					// FALSE if "fd" was not open
+
+    int NumFree() { return numFree; }	// How many descriptors are left?
+
+  private:
+    int tableSize;			// Number of descriptors, including
+					// the reserved console ones
+    OpenFile **table;			// The open file for each descriptor
+    int *freeList;			// Stack of unused descriptor numbers
+    int numFree;			// Number of entries on the stack
+};
+
+#endif // FDTABLE_H
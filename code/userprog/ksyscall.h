@@ -318,43 +318,186 @@ int SysRadomNum()
   return result;
 }
 
+/** 
+ * @brief Open a file and give it a descriptor in the current process
+ * @param name name of the file to open
+ * @return OpenFileId of the file, or -1 if the file can not be opened
+ * or the process already has too many files open
+*/
 OpenFileId SysOpenFile(char* name)
 {
   OpenFile* opf = kernel->fileSystem->Open(name);
 
-  if(opf != NULL)
+  if(opf == NULL)
   {
-    kernel->fileSystem->openf[0] = opf;
-    return 0;
+    return -1;
   }
-  else
+
+  OpenFileId id = kernel->currentThread->space->fileTable->Add(opf);
+
+  // no free descriptor left, close the file again
+  if(id == -1)
   {
-    kernel->fileSystem->openf[0] = NULL;
-    return -1;
+    delete opf;
   }
+  return id;
 }
 
+/** 
+ * @brief Close a file opened by the current process
+ * @param id descriptor of the file
+ * @return 0 on success, -1 if the descriptor is not an open file
+*/
 int SysCloseFile(OpenFileId id)
 {
-  OpenFile* opf = kernel->fileSystem->openf[id];
-  if(opf != NULL && id != -1)
+  if(kernel->currentThread->space->fileTable->Remove(id))
   {
-    delete kernel->fileSystem->openf[id];
-    kernel->fileSystem->openf[id] = NULL;
     return 0;
   }
-  else
+  return -1;
+}
+
+/** 
+ * @brief Check whether a descriptor refers to an open file
+ * @param id descriptor of the file
+ * @return True/False
+*/
+bool SysCheckOpenFileId(OpenFileId id)
+{
+  return kernel->currentThread->space->fileTable->Get(id) != NULL;
+}
+
+/** 
+ * @brief Read from an open file, or from the console if id is _ConsoleInput
+ * @param buffer kernel buffer to store the data
+ * @param size max number of bytes to read
+ * @param id descriptor of the file
+ * @return number of bytes read, or -1 if id is not readable
+*/
+int SysReadFile(char* buffer, int size, OpenFileId id)
+{
+  // console input stops at end of line, like a terminal read
+  if(id == _ConsoleInput)
+  {
+    int i = 0;
+    while(i < size)
+    {
+      char c = SysReadChar();
+      if(c == EOF)
+      {
+        break;
+      }
+      buffer[i++] = c;
+      if(c == LINE_FEED)
+      {
+        break;
+      }
+    }
+    return i;
+  }
+
+  OpenFile* opf = kernel->currentThread->space->fileTable->Get(id);
+  if(opf == NULL)
   {
     return -1;
   }
+  return opf->Read(buffer, size);
 }
 
-bool SysCheckOpenFileId(OpenFileId id) {
-  OpenFile* opf = kernel->fileSystem->openf[id];
-  if (opf == nullptr) {
-    return false;
+
+/** 
+ * @brief Create an empty file
+ * @param name name of the file to create
+ * @return 0 on success, -1 on failure
+*/
+int SysCreateFile(char* name)
+{
+#ifdef FILESYS_STUB
+  bool success = kernel->fileSystem->Create(name);
+#else
+  bool success = kernel->fileSystem->Create(name, 0);
+#endif
+  return success ? 0 : -1;
+}
+
+/** 
+ * @brief Remove a file
+ * @param name name of the file to remove
+ * @return 0 on success, -1 if the file does not exist
+*/
+int SysRemoveFile(char* name)
+{
+  return kernel->fileSystem->Remove(name) ? 0 : -1;
+}
+
+/** 
+ * @brief Write to an open file, or to the console if id is _ConsoleOutput
+ * @param buffer kernel buffer holding the data
+ * @param size number of bytes to write
+ * @param id descriptor of the file
+ * @return number of bytes written, or -1 if id is not writable
+*/
+int SysWriteFile(char* buffer, int size, OpenFileId id)
+{
+  if(id == _ConsoleOutput)
+  {
+    for(int i = 0; i < size; i++)
+    {
+      kernel->synchConsoleOut->PutChar(buffer[i]);
+    }
+    return size;
+  }
+
+  OpenFile* opf = kernel->currentThread->space->fileTable->Get(id);
+  if(opf == NULL)
+  {
+    return -1;
+  }
+  return opf->Write(buffer, size);
+}
+
+/** 
+ * @brief Move the read/write position of an open file
+ * @param position new position, or -1 to move to the end of the file
+ * @param id descriptor of the file
+ * @return the new position, or -1 if id is not a file or position
+ * is outside the file
+*/
+int SysSeekFile(int position, OpenFileId id)
+{
+  OpenFile* opf = kernel->currentThread->space->fileTable->Get(id);
+  if(opf == NULL)
+  {
+    return -1;
+  }
+
+  int length = opf->Length();
+  if(position == -1)
+  {
+    position = length;
+  }
+  if(position < 0 || position > length)
+  {
+    return -1;
+  }
+  opf->Seek(position);
+  return position;
+}
+
+/** 
+ * @brief Write everything written to an open file through to disk
+ * @param id descriptor of the file
+ * @return 0 on success, -1 if id is not an open file
+*/
+int SysFlushFile(OpenFileId id)
+{
+  OpenFile* opf = kernel->currentThread->space->fileTable->Get(id);
+  if(opf == NULL)
+  {
+    return -1;
   }
-  return true;
+  opf->Flush();
+  return 0;
 }
 
 
@@ -34,6 +34,7 @@
 #define SC_ExecV	13
 #define SC_ThreadExit   14
 #define SC_ThreadJoin   15
+#define SC_Flush        16
 
 #define SC_Add		    42
 #define SC_ReadNum      43
@@ -166,10 +167,11 @@ typedef int OpenFileId;
 
 /* Create a Nachos file, with name "name" */
 /* Note: Create does not open the file.   */
-/* Return 1 on success, negative error code on failure */
+/* Return 0 on success, -1 on failure */
 int Create(char *name);
 
 /* Remove a Nachos file, with name "name" */
+/* Return 0 on success, -1 if the file does not exist */
 int Remove(char *name);
 
 /* Open the Nachos file "name", and return an "OpenFileId" that can 
@@ -178,8 +180,8 @@ int Remove(char *name);
 OpenFileId Open(char *name);
 
 /* Write "size" bytes from "buffer" to the open file. 
- * Return the number of bytes actually read on success.
- * On failure, a negative error code is returned.
+ * Return the number of bytes actually written on success.
+ * On failure, -1 is returned.
  */
 int Write(char *buffer, int size, OpenFileId id);
 
@@ -192,15 +194,22 @@ int Write(char *buffer, int size, OpenFileId id);
 int Read(char *buffer, int size, OpenFileId id);
 
 /* Set the seek position of the open file "id"
- * to the byte "position".
+ * to the byte "position", or to the end of the file if "position"
+ * is -1.  Return the new position, or -1 on failure.
  */
 int Seek(int position, OpenFileId id);
 
 /* Close the file, we're done reading and writing to it.
- * Return 1 on success, negative error code on failure
+ * Return 0 on success, -1 on failure
  */
 int Close(OpenFileId id);
 
+/* Make sure everything written to the open file "id" is on disk, 
+ * rather than only in the kernel's disk cache (cf. UNIX fsync).
+ * Return 0 on success, -1 if "id" is not an open file.
+ */
+int Flush(OpenFileId id);
+
 
 /* User-level thread operations: Fork and Yield.  To allow multiple
  * threads to run within a user program. 